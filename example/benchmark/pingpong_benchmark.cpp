@@ -0,0 +1,166 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "salt/core/io_backend.h"
+#include "salt/core/tcp_client.h"
+#include "salt/core/tcp_server.h"
+#include "salt/packet_assemble/packet_assemble.h"
+#include "salt/version.h"
+
+/**
+ * pingpong benchmark：客户端给每个链接发一个包，服务器端和客户端收到数据后都原样发回去，
+ * 统计一段时间内客户端收到的字节数。
+ * 用来对比 epoll 和 io_uring 两种后端（编译时使用 -DSALT_USE_IO_URING=ON
+ * 切换），tcp_server 的 shared/per_thread 两种线程模式，以及回环 tcp 和 unix
+ * domain socket 两种传输方式。每个链接同时只有一个包在传输，
+ * 平均往返延迟为 链接数 / 每秒包数
+ *
+ * 用法：pingpong_benchmark [链接数] [秒数] [包大小] [线程数] [shared|per_thread]
+ *       [tcp|unix]
+ */
+
+static std::atomic<uint64_t> received_bytes{0};
+static std::atomic<uint32_t> connected_count{0};
+
+/**
+ * 收到什么就发回什么
+ *
+ */
+class pingpong_packet_assemble : public salt::base_packet_assemble {
+public:
+  explicit pingpong_packet_assemble(bool count) : count_(count) {}
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> connection,
+                std::string s) override {
+    return data_received(std::move(connection), std::string_view{s});
+  }
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> connection,
+                std::string_view s) override {
+    if (count_) {
+      received_bytes.fetch_add(s.size(), std::memory_order_relaxed);
+    }
+    connection->send(std::string{s}, nullptr);
+    return salt::data_read_result::success;
+  }
+
+private:
+  bool count_{false};
+};
+
+class pingpong_client_notify : public salt::tcp_client_notify {
+public:
+  void connection_connected(const std::string &remote_addr,
+                            uint16_t remote_port) override {
+    ++connected_count;
+  }
+
+  void connection_disconnected(const std::error_code &error_code,
+                               const std::string &remote_addr,
+                               uint16_t remote_port) override {
+    std::cerr << "disconnected from " << remote_addr << ":" << remote_port
+              << ", reason:" << error_code.message() << std::endl;
+  }
+
+  void connection_dropped(const std::string &remote_addr,
+                          uint16_t remote_port) override {}
+};
+
+/**
+ * tcp_client 以地址和端口区分链接，这里利用 127.0.0.0/8
+ * 都是回环地址的特点，给每个链接分配一个不同的地址
+ */
+static std::string loopback_address(uint32_t index) {
+  return "127.0." + std::to_string(index / 250) + "." +
+         std::to_string(index % 250 + 1);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t connection_count = argc > 1 ? std::atoi(argv[1]) : 64;
+  uint32_t seconds = argc > 2 ? std::atoi(argv[2]) : 10;
+  uint32_t message_size = argc > 3 ? std::atoi(argv[3]) : 64;
+  uint32_t thread_count = argc > 4 ? std::atoi(argv[4]) : 4;
+  auto mode = salt::transfer_io_mode::shared;
+  if (argc > 5 && std::string{argv[5]} == "per_thread") {
+    mode = salt::transfer_io_mode::per_thread;
+  }
+  bool unix_socket = argc > 6 && std::string{argv[6]} == "unix";
+  const uint16_t port = 2003;
+  const std::string unix_path = "/tmp/salt_pingpong_benchmark.sock";
+
+  salt::tcp_server server;
+  if (unix_socket) {
+    server.set_listen_unix_path(unix_path);
+  } else {
+    server.set_listen_port(port);
+  }
+  server.set_transfer_thread_count(thread_count)
+      .set_transfer_io_mode(mode)
+      .set_assemble_creator([] { return new pingpong_packet_assemble(false); });
+  if (auto err_code = server.start(); err_code) {
+    std::cerr << "server start error:" << err_code.message() << std::endl;
+    return 1;
+  }
+
+  salt::tcp_client client;
+  client.set_transfer_thread_count(thread_count)
+      .set_assemble_creator([] { return new pingpong_packet_assemble(true); })
+      .set_notify(std::make_unique<pingpong_client_notify>());
+
+  salt::connection_meta meta;
+  meta.retry_when_connection_error = false;
+  meta.socket.no_delay = true;
+  std::vector<uint64_t> connection_ids;
+  for (auto i = 0u; i < connection_count; ++i) {
+    connection_ids.push_back(unix_socket
+                                 ? client.connect_unix(unix_path, meta)
+                                 : client.connect(loopback_address(i), port,
+                                                  meta));
+  }
+  for (auto i = 0; i < 500 && connected_count < connection_count; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  if (connected_count < connection_count) {
+    std::cerr << "only " << connected_count << " of " << connection_count
+              << " connections connected" << std::endl;
+    return 1;
+  }
+
+  const std::string message(message_size, 'x');
+  for (auto connection_id : connection_ids) {
+    client.send(connection_id, message, nullptr);
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  auto bytes = received_bytes.load();
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+
+  std::cout << "salt " << salt::version << ", backend:"
+            << salt::io_backend_name(salt::current_io_backend())
+            << ", mode:"
+            << (mode == salt::transfer_io_mode::per_thread ? "per_thread"
+                                                           : "shared")
+            << ", transport:" << (unix_socket ? "unix" : "tcp")
+            << ", connections:" << connection_count
+            << ", message size:" << message_size
+            << ", threads:" << thread_count << std::endl;
+  auto messages_per_second = bytes / message_size / elapsed;
+  std::cout << "messages/s:" << messages_per_second
+            << ", MiB/s:" << bytes / elapsed / 1024 / 1024
+            << ", avg rtt us:" << connection_count / messages_per_second * 1e6
+            << std::endl;
+
+  client.stop();
+  server.stop();
+  return 0;
+}
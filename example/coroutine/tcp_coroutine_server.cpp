@@ -0,0 +1,78 @@
+#include <iostream>
+
+#include "salt/core/async_send.h"
+#include "salt/core/tcp_server.h"
+#include "salt/packet_assemble/header_body_assemble.h"
+#include "salt/packet_assemble/packet_channel.h"
+#include "salt/version.h"
+
+// 包头，与 message 示例中的包头一致
+struct message_header {
+  // magic 用于校验
+  uint32_t magic;
+
+  // 包长度
+  uint32_t len;
+
+  // 随便填了点东西，用来表明长度字段不一定非要是头部的最后一个字段
+  char what_ever[8];
+};
+
+using message_channel = salt::packet_channel<message_header>;
+
+/**
+ * 在协程中逐个读取包，并原样发回去。
+ * 读包和发包都不需要 std::function 回调，也不经过 tcp_client 的控制线程
+ */
+static asio::awaitable<void>
+echo(std::shared_ptr<message_channel> channel) {
+  try {
+    while (true) {
+      auto p = co_await channel->async_next_packet(asio::use_awaitable);
+      std::cout << "get message, content:" << p.body << std::endl;
+      auto connection = std::move(p.connection);
+      co_await salt::async_send(std::move(connection),
+                                std::move(p.raw_header_data) + p.body,
+                                asio::use_awaitable);
+    }
+  } catch (const std::system_error &e) {
+    // 队列关闭或者发送失败时 use_awaitable 会抛出异常
+    std::cout << "echo finish, reason:" << e.what() << std::endl;
+  }
+}
+
+/**
+ * 使用 C++20 协程的 tcp 服务器端示例
+ *
+ */
+int main() {
+  // 所有链接的包都放到同一个队列里，包里带有收到包的链接
+  auto channel = message_channel::create();
+
+  salt::tcp_server server;
+  server.set_listen_port(2004).set_assemble_creator([channel] {
+    auto assemble =
+        new salt::header_body_assemble<message_header, &message_header::len>();
+    assemble->set_notify(channel->make_notify());
+    return assemble;
+  });
+
+  auto err_code = server.start();
+  if (err_code) {
+    std::cerr << "server start error, salt version:" << salt::version
+              << std::endl;
+    return 1;
+  }
+  std::cout << "server start success, salt version:" << salt::version
+            << std::endl;
+
+  // 协程运行在自己的线程中
+  asio::io_context io_context;
+  asio::co_spawn(io_context, echo(channel), asio::detached);
+  std::thread coroutine_thread{[&io_context] { io_context.run(); }};
+
+  std::cin.get();
+  channel->close();
+  coroutine_thread.join();
+  return 0;
+}
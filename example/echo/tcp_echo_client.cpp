@@ -23,6 +23,8 @@ static void send_call_back(const std::error_code &error_code) {
  */
 class echo_packet_assemble : public salt::base_packet_assemble {
 public:
+  using salt::base_packet_assemble::data_received;
+
   salt::data_read_result
   data_received(std::shared_ptr<salt::connection_handle> connection,
                 std::string s) override {
@@ -23,6 +23,8 @@ static void send_call_back(const std::error_code &error_code) {
  */
 class echo_packet_assemble : public salt::base_packet_assemble {
 public:
+  using salt::base_packet_assemble::data_received;
+
   /**
    * 服务器接收到数据时会调用到这个方法，这里将收到的数据又发了回去
    */
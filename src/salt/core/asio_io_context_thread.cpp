@@ -2,7 +2,10 @@
 
 namespace salt {
 
-asio_io_context_thread::asio_io_context_thread() { run(); }
+asio_io_context_thread::asio_io_context_thread(int concurrency_hint)
+    : io_context_(concurrency_hint) {
+  run();
+}
 
 asio_io_context_thread::~asio_io_context_thread() { stop(); }
 
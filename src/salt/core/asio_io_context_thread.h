@@ -5,7 +5,14 @@
 namespace salt {
 class asio_io_context_thread {
 public:
-  asio_io_context_thread();
+  /**
+   * @brief 创建 io_context 并启动线程
+   *
+   * @param concurrency_hint 传给 io_context 的并发提示。只会被本线程 run 的
+   * io_context 可以传 ASIO_CONCURRENCY_HINT_1，让 asio 省掉部分跨线程的调度开销
+   */
+  explicit asio_io_context_thread(
+      int concurrency_hint = ASIO_CONCURRENCY_HINT_DEFAULT);
   ~asio_io_context_thread();
 
   void stop();
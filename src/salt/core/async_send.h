@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "asio.hpp"
+#include "salt/core/connection_handle.h"
+
+namespace salt {
+
+/**
+ * @brief 基于 asio completion token 的发送接口，可以配合
+ *        asio::use_awaitable 在 C++20 协程中使用：
+ *        co_await salt::async_send(connection, data, asio::use_awaitable);
+ *
+ *        直接在 connection_handle 上发送，不经过 tcp_client 的控制线程。
+ *        发送完成后，通过 token 关联的 executor 恢复执行，没有关联 executor
+ *        的回调会直接在传输线程中调用
+ *
+ * @tparam completion_token asio completion token 类型，完成签名为
+ * void(std::error_code)
+ * @param connection 发送数据的链接
+ * @param data 需要发送的数据
+ * @param token asio completion token，比如 asio::use_awaitable 或者回调函数
+ * @return 取决于 completion_token，asio::use_awaitable 时为
+ * asio::awaitable<void>
+ */
+template <typename completion_token>
+auto async_send(std::shared_ptr<connection_handle> connection, std::string data,
+                completion_token &&token) {
+  return asio::async_initiate<completion_token, void(std::error_code)>(
+      [](auto handler, std::shared_ptr<connection_handle> connection,
+         std::string data) {
+        using handler_type = decltype(handler);
+        struct send_operation {
+          explicit send_operation(handler_type &&handler)
+              : handler_(std::move(handler)),
+                work_(asio::make_work_guard(
+                    asio::get_associated_executor(handler_))) {}
+
+          handler_type handler_;
+          asio::executor_work_guard<
+              asio::associated_executor_t<handler_type>>
+              work_;
+        };
+
+        // connection_handle::send 需要可拷贝的回调，这里只分配一次共享状态
+        auto operation = std::make_shared<send_operation>(std::move(handler));
+        connection->send(
+            std::move(data), [operation](const std::error_code &err_code) {
+              auto executor = operation->work_.get_executor();
+              asio::dispatch(executor, [operation, err_code]() mutable {
+                auto handler = std::move(operation->handler_);
+                operation->work_.reset();
+                handler(err_code);
+              });
+            });
+      },
+      token, std::move(connection), std::move(data));
+}
+
+} // namespace salt
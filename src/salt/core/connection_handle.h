@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <string>
@@ -22,6 +24,61 @@ public:
    */
   virtual void send(std::string data,
                     std::function<void(const std::error_code &)> call_back) = 0;
+
+  /**
+   * @brief 获取发送队列中（包括正在发送）的字节数
+   *
+   * @return std::size_t 发送队列中的字节数
+   */
+  virtual std::size_t pending_send_bytes() const { return 0; }
+
+  /**
+   * @brief 链接是否处于拥塞状态，即发送队列的字节数超过了高水位并且还没有降到低水位以下
+   *
+   * @return true 链接拥塞，应该暂停发送
+   * @return false 链接可写
+   */
+  virtual bool write_congested() const { return false; }
+
+  /**
+   * @brief 设置链接拥塞状态变化的回调。发送队列字节数超过高水位时以 true
+   *        调用，降到低水位以下时以 false 调用。回调在传输线程中执行
+   *
+   * @param call_back 拥塞状态变化的回调，参数为链接是否拥塞
+   */
+  virtual void set_write_state_callback(
+      std::function<void(bool congested)> /* call_back */) {}
+
+  /**
+   * @brief 收到心跳回包时由拆包器调用，用最近一次发送心跳的时间计算 RTT，
+   *        详细说明请看 heartbeat_policy
+   *
+   */
+  virtual void pong_received() {}
+
+  /**
+   * @brief 请求断开链接，可以在任意线程中调用。链接在自己的线程中关闭，
+   *        效果与拆包器返回 data_read_result::disconnect 相同
+   *
+   */
+  virtual void close() {}
+
+  /**
+   * @brief 获取最近一次心跳测量的 RTT
+   *
+   * @return std::chrono::microseconds RTT，还没有测量时返回0
+   */
+  virtual std::chrono::microseconds rtt() const {
+    return std::chrono::microseconds{0};
+  }
+
+  /**
+   * @brief 获取链接 id，tcp_server 中每个链接的 id 唯一，可以用于
+   * tcp_server::send 向指定链接发送数据
+   *
+   * @return uint64_t 链接 id，0 表示没有 id
+   */
+  virtual uint64_t id() const { return 0; }
   virtual ~connection_handle() = default;
 };
 
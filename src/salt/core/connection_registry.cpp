@@ -0,0 +1,58 @@
+#include "salt/core/connection_registry.h"
+
+#include <algorithm>
+
+namespace salt {
+
+connection_registry::connection_registry(uint32_t shard_count /* = 64 */)
+    : shards_(std::max(shard_count, 1u)) {}
+
+void connection_registry::add(
+    uint64_t connection_id, const std::shared_ptr<tcp_connection> &connection) {
+  auto &shard = get_shard(connection_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.connections.insert_or_assign(connection_id, connection).second) {
+    size_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.snapshot.reset();
+}
+
+void connection_registry::remove(uint64_t connection_id) {
+  auto &shard = get_shard(connection_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.connections.erase(connection_id) == 0) {
+    return;
+  }
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  shard.snapshot.reset();
+}
+
+std::shared_ptr<tcp_connection>
+connection_registry::find(uint64_t connection_id) const {
+  auto &shard = get_shard(connection_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto pos = shard.connections.find(connection_id);
+  return pos == shard.connections.end() ? nullptr : pos->second.lock();
+}
+
+void connection_registry::for_each(
+    const std::function<void(const std::shared_ptr<tcp_connection> &)>
+        &call_back) const {
+  for (auto &shard : shards_) {
+    std::shared_ptr<const table> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (!shard.snapshot) {
+        shard.snapshot = std::make_shared<const table>(shard.connections);
+      }
+      snapshot = shard.snapshot;
+    }
+    for (const auto &item : *snapshot) {
+      if (auto connection = item.second.lock(); connection) {
+        call_back(connection);
+      }
+    }
+  }
+}
+
+} // namespace salt
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "salt/core/tcp_connection.h"
+
+namespace salt {
+
+/**
+ * @brief 以链接 id 为 key 的链接表。按照 id 分片，添加、删除和查找只在
+ *        分片的锁内修改或者查找一次，与分片大小无关。
+ *        遍历使用每个分片的只读快照，写操作只让快照失效，
+ *        由下一次遍历在锁内重新生成，遍历回调在锁外执行。
+ *        链接表只保存 weak_ptr，不会延长链接的生命周期
+ *
+ */
+class connection_registry {
+public:
+  /**
+   * @brief 创建链接表
+   *
+   * @param shard_count 分片数量，越大锁竞争越少，遍历时重新生成的快照越小
+   */
+  explicit connection_registry(uint32_t shard_count = 64);
+
+  void add(uint64_t connection_id,
+           const std::shared_ptr<tcp_connection> &connection);
+
+  void remove(uint64_t connection_id);
+
+  /**
+   * @brief 查找链接
+   *
+   * @param connection_id 链接 id
+   * @return std::shared_ptr<tcp_connection> 找到的链接，不存在或者已经释放时返回空
+   */
+  std::shared_ptr<tcp_connection> find(uint64_t connection_id) const;
+
+  /**
+   * @brief 遍历所有还没有释放的链接。遍历的是每个分片调用时的快照，
+   *        遍历过程中添加或者删除的链接不一定会被遍历到
+   *
+   * @param call_back 遍历回调
+   */
+  void for_each(
+      const std::function<void(const std::shared_ptr<tcp_connection> &)>
+          &call_back) const;
+
+  inline std::size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+private:
+  using table = std::unordered_map<uint64_t, std::weak_ptr<tcp_connection>>;
+
+  struct shard {
+    std::mutex mutex;
+    table connections;
+    // 遍历使用的快照，为空时表示已经失效
+    std::shared_ptr<const table> snapshot;
+  };
+
+  inline shard &get_shard(uint64_t connection_id) const {
+    return shards_[connection_id % shards_.size()];
+  }
+
+private:
+  mutable std::vector<shard> shards_;
+  std::atomic<std::size_t> size_{0};
+};
+
+} // namespace salt
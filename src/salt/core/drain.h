@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace salt {
+
+/**
+ * @brief 单个链接的优雅关闭统计
+ *
+ */
+struct connection_drain_stat {
+  std::string remote_address;
+  uint16_t remote_port{0};
+
+  /**
+   * @brief 开始关闭以后发送成功的字节数
+   *
+   */
+  std::size_t flushed_bytes{0};
+
+  /**
+   * @brief 关闭时还没有发送完，被丢弃的字节数
+   *
+   */
+  std::size_t dropped_bytes{0};
+
+  /**
+   * @brief 是否因为超时被强制关闭
+   *
+   */
+  bool timeout{false};
+
+  /**
+   * @brief 从开始关闭到发送完成（或者超时）的时间
+   *
+   */
+  std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @brief 优雅关闭的结果
+ *
+ */
+struct drain_result {
+  std::size_t flushed_bytes{0};
+  std::size_t dropped_bytes{0};
+  std::size_t timeout_count{0};
+
+  /**
+   * @brief 每个链接的统计
+   *
+   */
+  std::vector<connection_drain_stat> connections;
+};
+
+} // namespace salt
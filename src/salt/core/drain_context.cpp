@@ -0,0 +1,108 @@
+#include "salt/core/drain_context.h"
+
+#include "salt/core/log.h"
+#include "salt/util/call_back_wrapper.h"
+
+namespace salt {
+
+std::shared_ptr<drain_context>
+drain_context::create(asio::io_context &timer_io_context,
+                      std::function<void(const drain_result &)> call_back) {
+  return std::shared_ptr<drain_context>(
+      new drain_context(timer_io_context, std::move(call_back)));
+}
+
+void drain_context::start(
+    const std::vector<std::shared_ptr<tcp_connection>> &connections,
+    std::chrono::milliseconds timeout) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.assign(connections.begin(), connections.end());
+    reported_.assign(connections.size(), false);
+    remaining_ = connections.size();
+  }
+
+  log_info("start to drain %zu connections, timeout %lld ms",
+           connections.size(), static_cast<long long>(timeout.count()));
+  if (connections.empty()) {
+    call(call_back_, result_);
+    return;
+  }
+
+  auto self{shared_from_this()};
+  asio::post(timer_.get_executor(), [self, timeout] {
+    self->timer_.expires_after(timeout);
+    self->timer_.async_wait([self](const std::error_code &err_code) {
+      if (!err_code) {
+        self->_timeout();
+      }
+    });
+  });
+
+  for (auto i = 0u; i < connections.size(); ++i) {
+    connections[i]->drain([self, i](const connection_drain_stat &stat) {
+      self->_report(i, stat);
+    });
+  }
+}
+
+void drain_context::_report(std::size_t index,
+                            const connection_drain_stat &stat) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reported_[index]) {
+      return;
+    }
+    reported_[index] = true;
+    result_.flushed_bytes += stat.flushed_bytes;
+    result_.dropped_bytes += stat.dropped_bytes;
+    if (stat.timeout) {
+      ++result_.timeout_count;
+    }
+    result_.connections.push_back(stat);
+    if (--remaining_ != 0) {
+      return;
+    }
+  }
+
+  log_info("drain finish, flushed %zu bytes, dropped %zu bytes, %zu "
+           "connections timeout",
+           result_.flushed_bytes, result_.dropped_bytes,
+           result_.timeout_count);
+  auto self{shared_from_this()};
+  asio::post(timer_.get_executor(), [self] {
+    std::error_code err_code;
+    self->timer_.cancel(err_code);
+  });
+  call(call_back_, result_);
+}
+
+void drain_context::_timeout() {
+  std::vector<std::pair<std::size_t, std::shared_ptr<tcp_connection>>> alive;
+  std::vector<std::size_t> released;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto i = 0u; i < connections_.size(); ++i) {
+      if (reported_[i]) {
+        continue;
+      }
+      if (auto connection = connections_[i].lock(); connection) {
+        alive.emplace_back(i, std::move(connection));
+      } else {
+        released.push_back(i);
+      }
+    }
+  }
+
+  // 链接已经释放，没有机会再汇报，直接按照超时处理
+  for (auto index : released) {
+    connection_drain_stat stat;
+    stat.timeout = true;
+    _report(index, stat);
+  }
+  for (auto &connection : alive) {
+    connection.second->drain_timeout();
+  }
+}
+
+} // namespace salt
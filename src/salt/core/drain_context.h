@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "asio.hpp"
+
+#include "salt/core/drain.h"
+#include "salt/core/tcp_connection.h"
+
+namespace salt {
+
+/**
+ * @brief 协调一组链接的优雅关闭。所有链接发送完成，或者超时以后强制关闭剩下的链接，
+ *        然后调用一次完成回调
+ *
+ */
+class drain_context : public std::enable_shared_from_this<drain_context> {
+public:
+  /**
+   * @brief 创建优雅关闭的上下文
+   *
+   * @param timer_io_context 超时定时器使用的 io_context
+   * @param call_back 所有链接关闭完成的回调，在最后一个完成的链接所在线程中调用
+   * @return std::shared_ptr<drain_context> 创建好的上下文
+   */
+  static std::shared_ptr<drain_context>
+  create(asio::io_context &timer_io_context,
+         std::function<void(const drain_result &)> call_back);
+
+  /**
+   * @brief 开始关闭链接
+   *
+   * @param connections 需要关闭的链接
+   * @param timeout 超时时间，超时以后还没有发送完的数据会被丢弃
+   */
+  void start(const std::vector<std::shared_ptr<tcp_connection>> &connections,
+             std::chrono::milliseconds timeout);
+
+private:
+  drain_context(asio::io_context &timer_io_context,
+                std::function<void(const drain_result &)> call_back)
+      : timer_(asio::make_strand(timer_io_context)),
+        call_back_(std::move(call_back)) {}
+
+  void _report(std::size_t index, const connection_drain_stat &stat);
+
+  void _timeout();
+
+private:
+  asio::steady_timer timer_;
+  std::function<void(const drain_result &)> call_back_;
+  std::mutex mutex_;
+  std::vector<std::weak_ptr<tcp_connection>> connections_;
+  std::vector<bool> reported_;
+  std::size_t remaining_{0};
+  drain_result result_;
+};
+
+} // namespace salt
@@ -56,6 +56,18 @@ std::string salt_error_category::message(int ev) const {
   case error_code::acceptor_is_nullptr: {
     return "acceptor is nullptr";
   } break;
+  case error_code::idle_timeout: {
+    return "connection idle timeout";
+  } break;
+  case error_code::service_not_found: {
+    return "service not found";
+  } break;
+  case error_code::request_timeout: {
+    return "request timeout";
+  } break;
+  case error_code::too_many_requests: {
+    return "too many pending requests";
+  } break;
   default: {
     return "(unknown error)";
   } break;
@@ -92,6 +92,30 @@ enum class error_code {
    *
    */
   acceptor_is_nullptr,
+
+  /**
+   * @brief 链接空闲超时
+   *
+   */
+  idle_timeout,
+
+  /**
+   * @brief 服务不存在
+   *
+   */
+  service_not_found,
+
+  /**
+   * @brief 请求超时
+   *
+   */
+  request_timeout,
+
+  /**
+   * @brief 未完成的请求太多，没有可用的请求 id
+   *
+   */
+  too_many_requests,
 };
 
 /**
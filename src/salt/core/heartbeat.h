@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+namespace salt {
+
+/**
+ * @brief 链接的空闲超时和心跳配置。空闲时间按照最后一次收到数据的时间计算，
+ *        对端异常退出时数据仍然可以写入本地的内核缓冲区，所以发送数据不算活跃
+ *
+ */
+struct heartbeat_policy {
+  /**
+   * @brief 空闲超时时间，超过这个时间没有收到数据时断开链接，并以
+   *        error_code::idle_timeout 通知。设置为0则不检测空闲超时
+   *
+   */
+  std::chrono::milliseconds idle_timeout{0};
+
+  /**
+   * @brief 心跳间隔，超过这个时间没有收到数据时发送 ping_creator 创建的心跳包。
+   *        设置为0则不发送心跳，应该小于 idle_timeout
+   *
+   */
+  std::chrono::milliseconds ping_interval{0};
+
+  /**
+   * @brief 心跳包工厂函数，返回需要发送的心跳包。
+   *        拆包器收到对端的回包时调用 connection_handle::pong_received 可以计算
+   *        RTT，通过 connection_handle::rtt 获取
+   *
+   */
+  std::function<std::string()> ping_creator;
+
+  inline bool enabled() const {
+    return idle_timeout.count() > 0 ||
+           (ping_interval.count() > 0 && ping_creator);
+  }
+};
+
+} // namespace salt
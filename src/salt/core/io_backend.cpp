@@ -0,0 +1,28 @@
+#include "salt/core/io_backend.h"
+
+#include "asio.hpp"
+
+namespace salt {
+
+io_backend current_io_backend() {
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+  return io_backend::io_uring;
+#elif defined(ASIO_HAS_EPOLL)
+  return io_backend::epoll;
+#else
+  return io_backend::other;
+#endif
+}
+
+const char *io_backend_name(io_backend backend) {
+  switch (backend) {
+  case io_backend::epoll:
+    return "epoll";
+  case io_backend::io_uring:
+    return "io_uring";
+  default:
+    return "other";
+  }
+}
+
+} // namespace salt
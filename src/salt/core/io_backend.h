@@ -0,0 +1,44 @@
+#pragma once
+
+namespace salt {
+
+/**
+ * @brief asio 使用的 IO 后端
+ *
+ */
+enum class io_backend {
+  /**
+   * @brief linux epoll reactor，linux 下的默认后端
+   *
+   */
+  epoll = 1,
+
+  /**
+   * @brief linux io_uring，需要使用 -DSALT_USE_IO_URING=ON 编译 salt
+   *
+   */
+  io_uring,
+
+  /**
+   * @brief 其它平台的后端，比如 kqueue、iocp、select
+   *
+   */
+  other,
+};
+
+/**
+ * @brief 获取编译 salt 时选择的 IO 后端
+ *
+ * @return io_backend 当前使用的 IO 后端
+ */
+io_backend current_io_backend();
+
+/**
+ * @brief 获取 IO 后端的名字，用于日志或者 benchmark 输出
+ *
+ * @param backend IO 后端
+ * @return const char* 后端的名字
+ */
+const char *io_backend_name(io_backend backend);
+
+} // namespace salt
@@ -0,0 +1,49 @@
+#include "salt/core/io_timing_wheel.h"
+
+#include "salt/core/log.h"
+
+namespace salt {
+
+std::shared_ptr<io_timing_wheel>
+io_timing_wheel::create(asio::io_context &io_context,
+                        std::chrono::milliseconds tick /* = 100ms */,
+                        uint32_t slot_count /* = 512 */) {
+  return std::shared_ptr<io_timing_wheel>(
+      new io_timing_wheel(io_context, tick, slot_count));
+}
+
+void io_timing_wheel::start() {
+  asio::post(timer_.get_executor(),
+             [self = shared_from_this()] { self->_tick(); });
+}
+
+void io_timing_wheel::stop() {
+  stopped_.store(true, std::memory_order_relaxed);
+  // steady_timer 不是线程安全的，取消操作需要和 _tick 在同一个 strand 上执行
+  asio::post(timer_.get_executor(), [self = shared_from_this()] {
+    std::error_code err_code;
+    self->timer_.cancel(err_code);
+  });
+}
+
+void io_timing_wheel::_tick() {
+  if (stopped_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  wheel_.advance();
+  timer_.expires_after(wheel_.tick());
+  timer_.async_wait(
+      [self = shared_from_this()](const std::error_code &err_code) {
+        if (err_code) {
+          if (err_code != asio::error::operation_aborted) {
+            log_error("timing wheel timer error, reason:%s",
+                      err_code.message().c_str());
+          }
+          return;
+        }
+        self->_tick();
+      });
+}
+
+} // namespace salt
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "asio.hpp"
+
+#include "salt/util/timing_wheel.h"
+
+namespace salt {
+
+/**
+ * @brief 由 io_context 驱动的时间轮，每个 tick 推进一次。
+ *        链接的空闲超时和心跳都挂在这上面，避免每个链接创建一个 asio::steady_timer
+ *
+ */
+class io_timing_wheel : public std::enable_shared_from_this<io_timing_wheel> {
+public:
+  /**
+   * @brief 创建时间轮，创建以后需要调用 start 开始计时
+   *
+   * @param io_context 驱动时间轮的 io_context，到期的回调在这个 io_context
+   * 的线程中执行
+   * @param tick 每一格的时间
+   * @param slot_count 格子数量
+   * @return std::shared_ptr<io_timing_wheel> 创建好的时间轮
+   */
+  static std::shared_ptr<io_timing_wheel>
+  create(asio::io_context &io_context,
+         std::chrono::milliseconds tick = std::chrono::milliseconds{100},
+         uint32_t slot_count = 512);
+
+  void start();
+
+  /**
+   * @brief 停止计时，还没有触发的定时器不会再触发
+   *
+   */
+  void stop();
+
+  /**
+   * @brief 添加定时器，详细说明请看 timing_wheel::add
+   *
+   */
+  inline timing_wheel::timer_id add(std::chrono::milliseconds delay,
+                                    std::function<void()> callback) {
+    return wheel_.add(delay, std::move(callback));
+  }
+
+  /**
+   * @brief 取消定时器，详细说明请看 timing_wheel::cancel
+   *
+   */
+  inline bool cancel(timing_wheel::timer_id id) { return wheel_.cancel(id); }
+
+  inline std::size_t size() const { return wheel_.size(); }
+
+private:
+  io_timing_wheel(asio::io_context &io_context, std::chrono::milliseconds tick,
+                  uint32_t slot_count)
+      : wheel_(tick, slot_count), timer_(asio::make_strand(io_context)) {}
+
+  void _tick();
+
+private:
+  timing_wheel wheel_;
+  asio::steady_timer timer_;
+  std::atomic<bool> stopped_{false};
+};
+
+} // namespace salt
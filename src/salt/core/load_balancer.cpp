@@ -0,0 +1,105 @@
+#include "salt/core/load_balancer.h"
+
+#include <atomic>
+#include <random>
+#include <utility>
+
+namespace salt {
+
+static std::minstd_rand &random_engine() {
+  static thread_local std::minstd_rand engine{std::random_device{}()};
+  return engine;
+}
+
+/**
+ * @brief 从 candidates 中不重复地随机选两个，candidates 至少有两个元素
+ *
+ */
+static std::pair<std::size_t, std::size_t>
+pick_two(const std::vector<std::shared_ptr<connection_handle>> &candidates) {
+  auto &engine = random_engine();
+  auto first = std::uniform_int_distribution<std::size_t>{
+      0, candidates.size() - 1}(engine);
+  auto second = std::uniform_int_distribution<std::size_t>{
+      0, candidates.size() - 2}(engine);
+  if (second >= first) {
+    ++second;
+  }
+  return {first, second};
+}
+
+class round_robin_balancer : public load_balancer {
+public:
+  std::shared_ptr<connection_handle> select(
+      const std::vector<std::shared_ptr<connection_handle>> &candidates)
+      override {
+    if (candidates.empty()) {
+      return nullptr;
+    }
+    return candidates[next_.fetch_add(1, std::memory_order_relaxed) %
+                      candidates.size()];
+  }
+
+private:
+  std::atomic<std::size_t> next_{0};
+};
+
+class power_of_two_choices_balancer : public load_balancer {
+public:
+  std::shared_ptr<connection_handle> select(
+      const std::vector<std::shared_ptr<connection_handle>> &candidates)
+      override {
+    if (candidates.size() < 2) {
+      return candidates.empty() ? nullptr : candidates.front();
+    }
+
+    auto [first, second] = pick_two(candidates);
+    const auto &lhs = candidates[first];
+    const auto &rhs = candidates[second];
+    return rhs->pending_send_bytes() < lhs->pending_send_bytes() ? rhs : lhs;
+  }
+};
+
+class least_latency_balancer : public load_balancer {
+public:
+  std::shared_ptr<connection_handle> select(
+      const std::vector<std::shared_ptr<connection_handle>> &candidates)
+      override {
+    if (candidates.size() < 2) {
+      return candidates.empty() ? nullptr : candidates.front();
+    }
+
+    // 总是选 RTT 最小的链接会让流量集中到一个链接上，RTT 随之变大，
+    // 这里随机选两个比较，还没有测量 RTT 的链接优先，让它得到测量的机会
+    auto [first, second] = pick_two(candidates);
+    const auto &lhs = candidates[first];
+    const auto &rhs = candidates[second];
+    auto lhs_rtt = lhs->rtt();
+    auto rhs_rtt = rhs->rtt();
+    if (lhs_rtt.count() == 0 || rhs_rtt.count() == 0) {
+      return lhs_rtt.count() == 0 ? lhs : rhs;
+    }
+    if (lhs_rtt == rhs_rtt) {
+      return rhs->pending_send_bytes() < lhs->pending_send_bytes() ? rhs : lhs;
+    }
+    return rhs_rtt < lhs_rtt ? rhs : lhs;
+  }
+};
+
+std::unique_ptr<load_balancer>
+load_balancer::create(load_balance_policy policy) {
+  switch (policy) {
+  case load_balance_policy::power_of_two_choices: {
+    return std::make_unique<power_of_two_choices_balancer>();
+  } break;
+  case load_balance_policy::least_latency: {
+    return std::make_unique<least_latency_balancer>();
+  } break;
+  case load_balance_policy::round_robin:
+  default: {
+    return std::make_unique<round_robin_balancer>();
+  } break;
+  }
+}
+
+} // namespace salt
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "salt/core/connection_handle.h"
+
+namespace salt {
+
+/**
+ * @brief 负载均衡策略
+ *
+ */
+enum class load_balance_policy {
+  /**
+   * @brief 轮询
+   *
+   */
+  round_robin,
+
+  /**
+   * @brief 随机选择两个链接，使用发送队列字节数较少的一个
+   *
+   */
+  power_of_two_choices,
+
+  /**
+   * @brief 随机选择两个链接，使用心跳测量的 RTT 较小的一个，还没有测量 RTT
+   *        的链接优先，RTT 相同时使用发送队列字节数较少的一个。需要在
+   *        connection_meta 中配置心跳，并在拆包器中调用
+   *        connection_handle::pong_received
+   *
+   */
+  least_latency,
+};
+
+/**
+ * @brief 负载均衡器，从一个服务的所有已经建立的链接中选择一个发送数据
+ *
+ */
+class load_balancer {
+public:
+  virtual ~load_balancer() = default;
+
+  /**
+   * @brief 选择一个链接，可能在多个线程中同时调用
+   *
+   * @param candidates 候选链接，不能包含空指针
+   * @return std::shared_ptr<connection_handle> 选中的链接，没有候选链接时返回空
+   */
+  virtual std::shared_ptr<connection_handle>
+  select(const std::vector<std::shared_ptr<connection_handle>> &candidates) = 0;
+
+  /**
+   * @brief 创建负载均衡器
+   *
+   * @param policy 负载均衡策略
+   * @return std::unique_ptr<load_balancer> 创建好的负载均衡器
+   */
+  static std::unique_ptr<load_balancer> create(load_balance_policy policy);
+};
+
+} // namespace salt
@@ -0,0 +1,47 @@
+#include "salt/core/receive_buffer.h"
+
+#include <algorithm>
+
+#include "salt/core/log.h"
+
+namespace salt {
+
+receive_buffer_sizer::receive_buffer_sizer(const receive_buffer_policy &policy)
+    : policy_(policy) {
+  if (policy_.min_size == 0) {
+    log_info("receive buffer min size is 0, change to 1");
+    policy_.min_size = 1;
+  }
+  if (policy_.max_size < policy_.min_size) {
+    log_info("receive buffer max size %u less than min size %u, change to %u",
+             policy_.max_size, policy_.min_size, policy_.min_size);
+    policy_.max_size = policy_.min_size;
+  }
+
+  if (policy_.mode == receive_buffer_mode::adaptive) {
+    size_ = std::clamp(policy_.initial_size, policy_.min_size,
+                       policy_.max_size);
+  } else {
+    size_ = std::max(policy_.initial_size, 1u);
+  }
+}
+
+void receive_buffer_sizer::record(std::size_t read_size) {
+  if (policy_.mode != receive_buffer_mode::adaptive) {
+    return;
+  }
+
+  if (read_size >= size_) {
+    small_read_cnt_ = 0;
+    size_ = std::min<std::size_t>(size_ * 2, policy_.max_size);
+  } else if (read_size <= size_ / 2) {
+    if (++small_read_cnt_ >= policy_.shrink_after_reads) {
+      small_read_cnt_ = 0;
+      size_ = std::max<std::size_t>(size_ / 2, policy_.min_size);
+    }
+  } else {
+    small_read_cnt_ = 0;
+  }
+}
+
+} // namespace salt
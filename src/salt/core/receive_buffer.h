@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace salt {
+
+/**
+ * @brief 接收缓冲区大小的调整方式
+ *
+ */
+enum class receive_buffer_mode {
+  /**
+   * @brief 固定大小，始终使用 receive_buffer_policy::initial_size
+   *
+   */
+  fixed = 1,
+
+  /**
+   * @brief 根据最近几次读取的数据量自动扩大或者缩小接收缓冲区，
+   *        大小在 receive_buffer_policy::min_size 和
+   *        receive_buffer_policy::max_size 之间
+   *
+   */
+  adaptive,
+};
+
+/**
+ * @brief 链接接收缓冲区的配置
+ *
+ */
+struct receive_buffer_policy {
+  /**
+   * @brief 缓冲区大小的调整方式
+   *
+   */
+  receive_buffer_mode mode{receive_buffer_mode::fixed};
+
+  /**
+   * @brief 缓冲区初始大小，单位 byte
+   *
+   */
+  uint32_t initial_size{1024};
+
+  /**
+   * @brief 自适应模式下缓冲区的最小值，单位 byte
+   *
+   */
+  uint32_t min_size{512};
+
+  /**
+   * @brief 自适应模式下缓冲区的最大值，单位 byte
+   *
+   */
+  uint32_t max_size{64 * 1024};
+
+  /**
+   * @brief 自适应模式下，连续多少次读取的数据不足缓冲区的一半时缩小缓冲区
+   *
+   */
+  uint32_t shrink_after_reads{4};
+};
+
+/**
+ * @brief 根据 receive_buffer_policy 计算下一次读取使用的缓冲区大小。
+ *        一次读取填满了缓冲区时，缓冲区扩大一倍；连续
+ *        receive_buffer_policy::shrink_after_reads 次读取不足缓冲区一半时，缓冲区缩小一半
+ *
+ */
+class receive_buffer_sizer {
+public:
+  receive_buffer_sizer() : receive_buffer_sizer(receive_buffer_policy{}) {}
+
+  explicit receive_buffer_sizer(const receive_buffer_policy &policy);
+
+  /**
+   * @brief 下一次读取应该使用的缓冲区大小
+   *
+   * @return std::size_t 缓冲区大小
+   */
+  inline std::size_t size() const { return size_; }
+
+  /**
+   * @brief 记录一次读取的数据量，并调整下一次读取的缓冲区大小
+   *
+   * @param read_size 本次读取到的数据量
+   */
+  void record(std::size_t read_size);
+
+private:
+  receive_buffer_policy policy_;
+  std::size_t size_{0};
+  uint32_t small_read_cnt_{0};
+};
+
+} // namespace salt
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace salt {
+
+/**
+ * @brief 重连的指数退避配置。第 n 次重连的等待时间上限为
+ *        min(max_delay, initial_delay * multiplier^(n-1))，开启 full_jitter 时
+ *        在 [0, 上限] 中均匀随机，避免同一个服务端重启以后所有客户端同时重连
+ *
+ */
+struct reconnect_backoff {
+  /**
+   * @brief 第一次重连的等待时间上限，设置为0则不使用退避，按照
+   *        connection_meta::retry_interval_s 重连
+   *
+   */
+  std::chrono::milliseconds initial_delay{0};
+
+  /**
+   * @brief 等待时间上限的最大值
+   *
+   */
+  std::chrono::milliseconds max_delay{30 * 1000};
+
+  /**
+   * @brief 每次重连等待时间上限的倍数
+   *
+   */
+  double multiplier{2.0};
+
+  /**
+   * @brief 是否在 [0, 上限] 中随机等待时间
+   *
+   */
+  bool full_jitter{true};
+
+  inline bool enabled() const { return initial_delay.count() > 0; }
+
+  /**
+   * @brief 计算第 retry 次重连的等待时间上限
+   *
+   * @param retry 第几次重连，从1开始
+   * @return std::chrono::milliseconds 等待时间上限
+   */
+  inline std::chrono::milliseconds ceiling(uint32_t retry) const {
+    auto delay = static_cast<double>(initial_delay.count());
+    auto max = static_cast<double>(std::max(max_delay, initial_delay).count());
+    for (auto i = 1u; i < retry && delay < max; ++i) {
+      delay *= std::max(multiplier, 1.0);
+    }
+    return std::chrono::milliseconds{
+        static_cast<std::chrono::milliseconds::rep>(std::min(delay, max))};
+  }
+
+  /**
+   * @brief 计算第 retry 次重连的等待时间
+   *
+   * @param retry 第几次重连，从1开始
+   * @param engine 随机数引擎
+   * @return std::chrono::milliseconds 等待时间
+   */
+  template <typename random_engine_type>
+  inline std::chrono::milliseconds delay(uint32_t retry,
+                                         random_engine_type &engine) const {
+    auto upper = ceiling(retry);
+    if (!full_jitter) {
+      return upper;
+    }
+    return std::chrono::milliseconds{
+        std::uniform_int_distribution<std::chrono::milliseconds::rep>{
+            0, upper.count()}(engine)};
+  }
+};
+
+} // namespace salt
@@ -0,0 +1,155 @@
+#include "salt/core/resolve_cache.h"
+
+#include <utility>
+
+#include "salt/core/log.h"
+#include "salt/util/call_back_wrapper.h"
+
+namespace salt {
+
+resolve_cache::resolve_cache(asio::io_context &io_context)
+    : resolver_(io_context) {}
+
+void resolve_cache::set_policy(const resolve_cache_policy &policy) {
+  policy_ = policy;
+}
+
+void resolve_cache::async_resolve(const std::string &host, uint16_t port,
+                                  resolve_callback call_back) {
+  std::error_code err_code;
+  auto address = asio::ip::make_address(host, err_code);
+  if (!err_code) {
+    call(call_back, std::error_code{},
+         endpoints{asio::ip::tcp::endpoint{address, port}});
+    return;
+  }
+
+  auto now = clock::now();
+  auto found = entries_.find(host);
+  if (found == entries_.end()) {
+    if (entries_.size() >= policy_.max_entries) {
+      _evict_expired(now);
+    }
+    found = entries_.emplace(host, entry{}).first;
+  }
+
+  auto &cached = found->second;
+  if (cached.resolved && now < cached.expire) {
+    if (cached.error) {
+      call(call_back, cached.error, endpoints{});
+      return;
+    }
+
+    auto result = _to_endpoints(cached.addresses, port);
+    if (!cached.resolving && cached.expire - now < policy_.refresh_ahead) {
+      log_debug("refresh resolve cache of %s in background", host.c_str());
+      _lookup(found->first, cached);
+    }
+    call(call_back, std::error_code{}, std::move(result));
+    return;
+  }
+
+  cached.waiters.push_back(waiter{port, std::move(call_back)});
+  if (!cached.resolving) {
+    _lookup(found->first, cached);
+  }
+}
+
+void resolve_cache::clear() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.resolving) {
+      it->second.resolved = false;
+      ++it;
+    } else {
+      it = entries_.erase(it);
+    }
+  }
+}
+
+void resolve_cache::cancel() { resolver_.cancel(); }
+
+void resolve_cache::_lookup(const std::string &host, entry &cached) {
+  cached.resolving = true;
+  resolver_.async_resolve(
+      host, "0", asio::ip::tcp::resolver::numeric_service,
+      [this, host](const std::error_code &err_code,
+                   asio::ip::tcp::resolver::results_type result) {
+        _handle_lookup(host, err_code, std::move(result));
+      });
+}
+
+void resolve_cache::_handle_lookup(
+    const std::string &host, const std::error_code &err_code,
+    asio::ip::tcp::resolver::results_type result) {
+  auto found = entries_.find(host);
+  if (found == entries_.end()) {
+    return;
+  }
+
+  auto &cached = found->second;
+  cached.resolving = false;
+  auto now = clock::now();
+  auto waiters = std::move(cached.waiters);
+  cached.waiters.clear();
+  std::vector<asio::ip::address> addresses;
+  for (const auto &item : result) {
+    addresses.push_back(item.endpoint().address());
+  }
+
+  if (!err_code) {
+    cached.addresses = addresses;
+    cached.error.clear();
+    cached.resolved = policy_.ttl.count() > 0;
+    cached.expire = now + policy_.ttl;
+  } else if (err_code == asio::error::operation_aborted) {
+    // 被取消的解析不代表域名不可用，不缓存
+  } else if (cached.resolved && !cached.error && now < cached.expire) {
+    // 后台刷新失败，继续使用原来的结果直到过期
+    log_info("refresh resolve cache of %s failed, error:%s", host.c_str(),
+             err_code.message().c_str());
+  } else {
+    log_debug("resolve %s failed, error:%s", host.c_str(),
+              err_code.message().c_str());
+    cached.addresses.clear();
+    cached.error = err_code;
+    cached.resolved = policy_.negative_ttl.count() > 0;
+    cached.expire = now + policy_.negative_ttl;
+  }
+
+  if (!cached.resolved) {
+    entries_.erase(found);
+  }
+
+  // 回调中可能再次解析或者清空缓存，不能再访问 cached
+  for (auto &item : waiters) {
+    if (err_code) {
+      call(item.call_back, err_code, endpoints{});
+    } else {
+      call(item.call_back, std::error_code{},
+           _to_endpoints(addresses, item.port));
+    }
+  }
+}
+
+void resolve_cache::_evict_expired(clock::time_point now) {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (!it->second.resolving && now >= it->second.expire) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+resolve_cache::endpoints
+resolve_cache::_to_endpoints(const std::vector<asio::ip::address> &addresses,
+                             uint16_t port) {
+  endpoints result;
+  result.reserve(addresses.size());
+  for (const auto &address : addresses) {
+    result.emplace_back(address, port);
+  }
+  return result;
+}
+
+} // namespace salt
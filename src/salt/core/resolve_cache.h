@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "asio.hpp"
+
+namespace salt {
+
+/**
+ * @brief 域名解析缓存的配置。系统解析接口拿不到 DNS 记录的 TTL，
+ *        所以缓存时间由使用者配置
+ *
+ */
+struct resolve_cache_policy {
+  /**
+   * @brief 解析成功的结果缓存多久，设置为0则不缓存，每次都重新解析
+   *
+   */
+  std::chrono::milliseconds ttl{30 * 1000};
+
+  /**
+   * @brief 解析失败的结果缓存多久，期间同一个域名直接以上次的错误失败，
+   *        设置为0则不缓存失败的结果
+   *
+   */
+  std::chrono::milliseconds negative_ttl{5 * 1000};
+
+  /**
+   * @brief 缓存的结果剩余时间少于这个值时，继续使用缓存的结果，
+   *        同时在后台重新解析。后台解析失败时保留原来的结果直到过期
+   *
+   */
+  std::chrono::milliseconds refresh_ahead{5 * 1000};
+
+  /**
+   * @brief 缓存的最大域名数量，超过以后清理已经过期的域名
+   *
+   */
+  std::size_t max_entries{1024};
+};
+
+/**
+ * @brief 域名解析缓存。数字形式的地址直接解析，不经过系统解析接口；
+ *        同一个域名同时只有一次解析，其它请求等待这次解析的结果。
+ *        非线程安全，所有接口和回调都在构造时传入的 io_context 的线程中调用
+ *
+ */
+class resolve_cache {
+public:
+  using endpoints = std::vector<asio::ip::tcp::endpoint>;
+
+  /**
+   * @brief 解析完成的回调，成功时 result 为解析结果，按照系统解析接口返回的顺序排列
+   *
+   */
+  using resolve_callback =
+      std::function<void(const std::error_code &error_code, endpoints result)>;
+
+  explicit resolve_cache(asio::io_context &io_context);
+
+  resolve_cache(const resolve_cache &) = delete;
+  resolve_cache &operator=(const resolve_cache &) = delete;
+
+  /**
+   * @brief 设置缓存的配置，对之后的解析生效
+   *
+   * @param policy 缓存的配置
+   */
+  void set_policy(const resolve_cache_policy &policy);
+
+  /**
+   * @brief 解析地址。数字形式的地址和命中缓存时直接在这个函数中调用回调
+   *
+   * @param host 域名或者数字形式的地址
+   * @param port 端口
+   * @param call_back 解析完成的回调，有且仅有一次调用
+   */
+  void async_resolve(const std::string &host, uint16_t port,
+                     resolve_callback call_back);
+
+  /**
+   * @brief 清空缓存，不影响进行中的解析
+   *
+   */
+  void clear();
+
+  /**
+   * @brief 取消进行中的解析，等待中的回调以 asio::error::operation_aborted
+   * 完成
+   *
+   */
+  void cancel();
+
+  /**
+   * @brief 获取缓存的域名数量，包括进行中的解析
+   *
+   * @return std::size_t 缓存的域名数量
+   */
+  inline std::size_t size() const { return entries_.size(); }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct waiter {
+    uint16_t port;
+    resolve_callback call_back;
+  };
+
+  struct entry {
+    std::vector<asio::ip::address> addresses;
+    std::error_code error;
+    clock::time_point expire;
+    bool resolved{false};
+    bool resolving{false};
+    std::vector<waiter> waiters;
+  };
+
+  void _lookup(const std::string &host, entry &cached);
+
+  void _handle_lookup(const std::string &host,
+                      const std::error_code &error_code,
+                      asio::ip::tcp::resolver::results_type result);
+
+  void _evict_expired(clock::time_point now);
+
+  static endpoints
+  _to_endpoints(const std::vector<asio::ip::address> &addresses,
+                uint16_t port);
+
+private:
+  asio::ip::tcp::resolver resolver_;
+  resolve_cache_policy policy_;
+  std::unordered_map<std::string, entry> entries_;
+};
+
+} // namespace salt
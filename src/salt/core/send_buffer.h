@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace salt {
+
+/**
+ * @brief 链接发送队列的配置，所有限制都按照队列中（包括正在发送）的字节数计算
+ *
+ */
+struct send_buffer_policy {
+  /**
+   * @brief 高水位，队列中的字节数达到这个值时链接进入拥塞状态，
+   *        并通知使用者暂停发送。设置为0则不检测拥塞
+   *
+   */
+  std::size_t high_watermark{4 * 1024 * 1024};
+
+  /**
+   * @brief 低水位，链接处于拥塞状态时，队列中的字节数降到这个值以下时，
+   *        链接恢复可写状态，并通知使用者继续发送
+   *
+   */
+  std::size_t low_watermark{1024 * 1024};
+
+  /**
+   * @brief 发送队列字节数的硬上限，超过这个限制的数据会被丢弃，并返回
+   *        error_code::send_queue_full。设置为0则不限制
+   *
+   */
+  std::size_t max_bytes{64 * 1024 * 1024};
+};
+
+} // namespace salt
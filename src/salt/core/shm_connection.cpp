@@ -0,0 +1,470 @@
+#include "salt/core/shm_connection.h"
+
+#include <chrono>
+#include <vector>
+
+#include "asio.hpp"
+
+#include "salt/core/error.h"
+#include "salt/core/log.h"
+#include "salt/util/call_back_wrapper.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace salt {
+
+static constexpr uint32_t shm_magic = 0x73616c74; // "salt"
+static constexpr uint32_t shm_version = 1;
+static constexpr std::size_t shm_min_ring_capacity = 4096;
+
+/**
+ * @brief 一方的状态，waiting 同时作为 futex 使用
+ *
+ */
+struct shm_connection::side_state {
+  alignas(64) std::atomic<uint32_t> waiting{0};
+  std::atomic<uint32_t> closed{0};
+};
+
+/**
+ * @brief 共享内存开头的控制信息，之后依次是创建方写入、打开方写入的两个 shm_ring
+ *
+ */
+struct shm_connection::control_block {
+  std::atomic<uint32_t> magic{0};
+  uint32_t version{shm_version};
+  uint64_t ring_capacity{0};
+  side_state sides[2];
+};
+
+static std::size_t round_up_capacity(std::size_t capacity) {
+  std::size_t result = shm_min_ring_capacity;
+  while (result < capacity) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+#ifdef __linux__
+static void futex_wait(std::atomic<uint32_t> &word, uint32_t expected,
+                       std::chrono::milliseconds timeout) {
+  timespec spec{};
+  spec.tv_sec = timeout.count() / 1000;
+  spec.tv_nsec = (timeout.count() % 1000) * 1000 * 1000;
+  // 共享内存在两个进程中的地址不同，不能使用 FUTEX_PRIVATE_FLAG
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT,
+            expected, &spec, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t> &word) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1,
+            nullptr, nullptr, 0);
+}
+
+static std::error_code last_error() {
+  return std::error_code{errno, std::system_category()};
+}
+#endif
+
+std::shared_ptr<shm_connection>
+shm_connection::create(const std::string &name, std::size_t ring_capacity,
+                       base_packet_assemble *packet_assemble,
+                       std::error_code &error_code) {
+#ifdef __linux__
+  ring_capacity = round_up_capacity(ring_capacity);
+  auto region_size =
+      sizeof(control_block) + 2 * shm_ring::region_size(ring_capacity);
+  auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    error_code = last_error();
+    log_error("create shared memory %s error, reason:%s", name.c_str(),
+              error_code.message().c_str());
+    delete packet_assemble;
+    return nullptr;
+  }
+
+  void *region = MAP_FAILED;
+  if (::ftruncate(fd, static_cast<off_t>(region_size)) == 0) {
+    region = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  }
+  if (region == MAP_FAILED) {
+    error_code = last_error();
+    log_error("map shared memory %s error, reason:%s", name.c_str(),
+              error_code.message().c_str());
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    delete packet_assemble;
+    return nullptr;
+  }
+  ::close(fd);
+
+  auto control = new (region) control_block;
+  control->ring_capacity = ring_capacity;
+  auto ring_memory = static_cast<char *>(region) + sizeof(control_block);
+  shm_ring::init(ring_memory, ring_capacity);
+  shm_ring::init(ring_memory + shm_ring::region_size(ring_capacity),
+                 ring_capacity);
+  // 最后写入 magic，打开方看到 magic 以后环形缓冲区一定已经初始化完成
+  control->magic.store(shm_magic, std::memory_order_release);
+
+  error_code.clear();
+  auto connection = std::shared_ptr<shm_connection>(new shm_connection(
+      name, true, region, region_size, packet_assemble));
+  connection->handle_ = std::make_shared<shm_connection_handle>(connection);
+  return connection;
+#else
+  error_code = std::make_error_code(std::errc::operation_not_supported);
+  delete packet_assemble;
+  return nullptr;
+#endif
+}
+
+std::shared_ptr<shm_connection>
+shm_connection::open(const std::string &name,
+                     base_packet_assemble *packet_assemble,
+                     std::error_code &error_code) {
+#ifdef __linux__
+  auto fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    error_code = last_error();
+    log_error("open shared memory %s error, reason:%s", name.c_str(),
+              error_code.message().c_str());
+    delete packet_assemble;
+    return nullptr;
+  }
+
+  struct stat file_stat;
+  void *region = MAP_FAILED;
+  std::size_t region_size{0};
+  if (::fstat(fd, &file_stat) == 0 &&
+      static_cast<std::size_t>(file_stat.st_size) >= sizeof(control_block)) {
+    region_size = static_cast<std::size_t>(file_stat.st_size);
+    region = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  }
+  error_code = region == MAP_FAILED
+                   ? std::make_error_code(std::errc::invalid_argument)
+                   : std::error_code{};
+  ::close(fd);
+
+  if (!error_code) {
+    auto control = static_cast<control_block *>(region);
+    auto ring_capacity = control->ring_capacity;
+    if (control->magic.load(std::memory_order_acquire) != shm_magic ||
+        control->version != shm_version ||
+        region_size != sizeof(control_block) +
+                           2 * shm_ring::region_size(ring_capacity)) {
+      // 创建方还没有初始化完成，或者不是 shm_connection 创建的共享内存
+      error_code = std::make_error_code(std::errc::invalid_argument);
+      ::munmap(region, region_size);
+    }
+  }
+  if (error_code) {
+    log_error("open shared memory %s error, reason:%s", name.c_str(),
+              error_code.message().c_str());
+    delete packet_assemble;
+    return nullptr;
+  }
+
+  auto connection = std::shared_ptr<shm_connection>(new shm_connection(
+      name, false, region, region_size, packet_assemble));
+  connection->handle_ = std::make_shared<shm_connection_handle>(connection);
+  return connection;
+#else
+  error_code = std::make_error_code(std::errc::operation_not_supported);
+  delete packet_assemble;
+  return nullptr;
+#endif
+}
+
+shm_connection::shm_connection(std::string name, bool owner, void *region,
+                               std::size_t region_size,
+                               base_packet_assemble *packet_assemble)
+    : name_(std::move(name)), owner_(owner), region_(region),
+      region_size_(region_size),
+      control_(static_cast<control_block *>(region)),
+      read_ring_(static_cast<char *>(region) + sizeof(control_block) +
+                 (owner ? shm_ring::region_size(control_->ring_capacity) : 0)),
+      write_ring_(static_cast<char *>(region) + sizeof(control_block) +
+                  (owner ? 0 : shm_ring::region_size(control_->ring_capacity))),
+      packet_assemble_(packet_assemble) {
+  if (std::thread::hardware_concurrency() == 1) {
+    // 只有一个 CPU 时空转只会占用对端需要的时间片
+    spin_count_ = 0;
+  }
+  log_debug("create shm_connection:%p, name:%s", this, name_.c_str());
+}
+
+shm_connection::~shm_connection() {
+  log_debug("~shm_connection:%p", this);
+  disconnect();
+#ifdef __linux__
+  ::munmap(region_, region_size_);
+  if (owner_) {
+    ::shm_unlink(name_.c_str());
+  }
+#endif
+}
+
+shm_connection::side_state &shm_connection::_self() {
+  return control_->sides[owner_ ? 0 : 1];
+}
+
+shm_connection::side_state &shm_connection::_peer() {
+  return control_->sides[owner_ ? 1 : 0];
+}
+
+void shm_connection::start(
+    std::function<void(const std::error_code &)> disconnect_callback) {
+  disconnect_callback_ = std::move(disconnect_callback);
+  thread_ = std::thread([_this = shared_from_this()]() mutable {
+    _this->_run();
+    // 最后一个引用可能在这里释放，析构函数中会 detach 当前线程
+    _this.reset();
+  });
+}
+
+void shm_connection::send(
+    std::string data, std::function<void(const std::error_code &)> call_back) {
+  if (stopped_.load(std::memory_order_acquire) ||
+      _peer().closed.load(std::memory_order_acquire)) {
+    call(call_back, make_error_code(error_code::not_connected));
+    return;
+  }
+
+  bool written{false};
+  bool queued{false};
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    if (send_items_.empty() && write_ring_.writable() >= data.size()) {
+      write_ring_.write_some(data);
+      written = true;
+    } else {
+      auto size = data.size();
+      auto pending =
+          pending_send_bytes_.fetch_add(size, std::memory_order_relaxed) +
+          size;
+      if (send_buffer_policy_.max_bytes != 0 &&
+          pending > send_buffer_policy_.max_bytes) {
+        pending_send_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        log_error("too many send bytes(%zu), limit:%zu, drop data", pending,
+                  send_buffer_policy_.max_bytes);
+      } else {
+        send_items_.emplace_back(std::move(data), std::move(call_back));
+        queued = true;
+      }
+    }
+  }
+
+  if (queued) {
+    // 已经放入发送队列，读取线程可能已经在等待，需要唤醒它在对端读取以后写入
+    _wake(_self());
+    return;
+  }
+
+  if (written) {
+    _notify_peer();
+    call(call_back, std::error_code{});
+  } else {
+    call(call_back, make_error_code(error_code::send_queue_full));
+  }
+}
+
+void shm_connection::disconnect() {
+  if (!stopped_.exchange(true, std::memory_order_acq_rel)) {
+    log_debug("shm_connection %s disconnect", name_.c_str());
+    _self().closed.store(1, std::memory_order_release);
+    _notify_peer();
+#ifdef __linux__
+    futex_wake(_self().waiting);
+#endif
+  }
+
+  if (thread_.joinable()) {
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+
+  decltype(send_items_) dropped_items;
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    dropped_items.swap(send_items_);
+    send_offset_ = 0;
+    pending_send_bytes_.store(0, std::memory_order_relaxed);
+  }
+  // 读取线程已经退出，在锁外调用回调，回调中可以再次调用 send
+  for (auto &item : dropped_items) {
+    call(item.second,
+         asio::error::make_error_code(asio::error::operation_aborted));
+  }
+}
+
+void shm_connection::close() {
+  close_requested_.store(true, std::memory_order_release);
+  _wake(_self());
+}
+
+void shm_connection::_run() {
+  auto &self = _self();
+  auto &peer = _peer();
+  uint32_t idle{0};
+  while (!stopped_.load(std::memory_order_acquire)) {
+    if (close_requested_.load(std::memory_order_acquire)) {
+      _close(make_error_code(error_code::require_disconnecet));
+      return;
+    }
+
+    bool progressed{false};
+    if (read_ring_.readable() > 0) {
+      if (!_read()) {
+        return;
+      }
+      progressed = true;
+    }
+    if (pending_send_bytes() > 0 && _flush()) {
+      progressed = true;
+    }
+    if (progressed) {
+      idle = 0;
+      continue;
+    }
+
+    if (peer.closed.load(std::memory_order_acquire) &&
+        read_ring_.readable() == 0) {
+      _close(asio::error::make_error_code(asio::error::eof));
+      return;
+    }
+
+    if (++idle < spin_count_) {
+      cpu_relax();
+      continue;
+    }
+
+    // 先声明自己在等待再检查一次，与对端写入以后检查 waiting 的顺序配合，
+    // 保证不会错过唤醒
+    self.waiting.store(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (read_ring_.readable() == 0 &&
+        !(pending_send_bytes() > 0 && write_ring_.writable() > 0) &&
+        !peer.closed.load(std::memory_order_acquire) &&
+        !stopped_.load(std::memory_order_acquire) &&
+        !close_requested_.load(std::memory_order_acquire)) {
+#ifdef __linux__
+      futex_wait(self.waiting, 1, std::chrono::milliseconds{100});
+#endif
+    }
+    self.waiting.store(0, std::memory_order_relaxed);
+    idle = 0;
+  }
+}
+
+bool shm_connection::_read() {
+  // 数据回绕时分两次交给拆包器
+  auto data = read_ring_.peek();
+  auto read_result = packet_assemble_->data_received(handle_, data);
+  read_ring_.consume(data.size());
+  // 对端可能在等待空间写入发送队列中的数据
+  _notify_peer();
+  if (read_result == data_read_result::disconnect) {
+    log_error("shm_connection %s packet assemble return disconnect",
+              name_.c_str());
+    _close(make_error_code(error_code::require_disconnecet));
+    return false;
+  } else if (read_result == data_read_result::error) {
+    log_error("shm_connection %s read data error, but continue read",
+              name_.c_str());
+  }
+  return true;
+}
+
+bool shm_connection::_flush() {
+  std::vector<std::function<void(const std::error_code &)>> call_backs;
+  std::size_t written{0};
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    while (!send_items_.empty()) {
+      auto &item = send_items_.front();
+      auto size = write_ring_.write_some(
+          std::string_view{item.first}.substr(send_offset_));
+      written += size;
+      send_offset_ += size;
+      if (send_offset_ < item.first.size()) {
+        break;
+      }
+      call_backs.push_back(std::move(item.second));
+      send_items_.pop_front();
+      send_offset_ = 0;
+    }
+    pending_send_bytes_.fetch_sub(written, std::memory_order_relaxed);
+  }
+
+  if (written > 0) {
+    _notify_peer();
+  }
+  for (auto &call_back : call_backs) {
+    call(call_back, std::error_code{});
+  }
+  return written > 0;
+}
+
+void shm_connection::_close(const std::error_code &error_code) {
+  stopped_.store(true, std::memory_order_release);
+  _self().closed.store(1, std::memory_order_release);
+  _notify_peer();
+  call(disconnect_callback_, error_code);
+}
+
+void shm_connection::_notify_peer() { _wake(_peer()); }
+
+void shm_connection::_wake(side_state &side) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (side.waiting.load(std::memory_order_relaxed) != 0 &&
+      side.waiting.exchange(0, std::memory_order_relaxed) != 0) {
+#ifdef __linux__
+    futex_wake(side.waiting);
+#endif
+  }
+}
+
+void shm_connection_handle::send(
+    std::string data, std::function<void(const std::error_code &)> call_back) {
+  auto connection = connection_.lock();
+  if (!connection) {
+    call(call_back, make_error_code(error_code::null_connection));
+    return;
+  }
+
+  connection->send(std::move(data), std::move(call_back));
+}
+
+std::size_t shm_connection_handle::pending_send_bytes() const {
+  auto connection = connection_.lock();
+  return connection ? connection->pending_send_bytes() : 0;
+}
+
+void shm_connection_handle::close() {
+  if (auto connection = connection_.lock(); connection) {
+    connection->close();
+  }
+}
+
+} // namespace salt
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "salt/core/connection_handle.h"
+#include "salt/core/send_buffer.h"
+#include "salt/core/shm_ring.h"
+#include "salt/packet_assemble/packet_assemble.h"
+
+namespace salt {
+
+/**
+ * @brief 基于共享内存的链接，用于同一台机器上的两个进程之间大量小包的传输。
+ *        共享内存中有两个方向的 shm_ring，发送时直接把数据复制到对端读取的环形缓冲区中，
+ *        接收时拆包器直接读取共享内存中的数据，不经过内核。
+ *        读取线程空闲一段时间以后在 futex 上等待，只有对端发现读取线程在等待时才需要唤醒，
+ *        忙碌时收发数据都没有系统调用。仅 linux 可用
+ *
+ *        一方调用 create 创建共享内存，另一方使用同一个名字调用 open。
+ *        对端进程异常退出时无法感知，需要配合应用层的心跳检测
+ *
+ */
+class shm_connection : public std::enable_shared_from_this<shm_connection> {
+public:
+  /**
+   * @brief 创建共享内存并创建链接，共享内存在链接释放时删除
+   *
+   * @param name 共享内存名字，传给 shm_open，需要以 '/' 开头
+   * @param ring_capacity 每个方向的环形缓冲区大小，会向上取整到2的幂，最小 4KB
+   * @param packet_assemble 链接的拆包器，链接会接管拆包器的生命周期
+   * @param error_code 创建结果，共享内存已经存在时失败
+   * @return std::shared_ptr<shm_connection> 创建的链接，失败时返回空
+   */
+  static std::shared_ptr<shm_connection>
+  create(const std::string &name, std::size_t ring_capacity,
+         base_packet_assemble *packet_assemble, std::error_code &error_code);
+
+  /**
+   * @brief 打开另一方创建的共享内存并创建链接
+   *
+   * @param name 共享内存名字，与 create 的名字相同
+   * @param packet_assemble 链接的拆包器，链接会接管拆包器的生命周期
+   * @param error_code 打开结果，共享内存不存在或者还没有初始化完成时失败
+   * @return std::shared_ptr<shm_connection> 创建的链接，失败时返回空
+   */
+  static std::shared_ptr<shm_connection>
+  open(const std::string &name, base_packet_assemble *packet_assemble,
+       std::error_code &error_code);
+
+  ~shm_connection();
+
+  /**
+   * @brief 启动读取线程。拆包器和发送队列中数据的回调都在读取线程中调用。
+   *        读取线程持有链接，不再使用时需要调用 disconnect
+   *
+   * @param disconnect_callback 对端关闭链接或者拆包器要求断开链接时的回调，
+   *        在读取线程中调用
+   */
+  void start(std::function<void(const std::error_code &)> disconnect_callback);
+
+  /**
+   * @brief 发送数据，可以在任意线程中调用。对端的环形缓冲区有足够空间时直接写入，
+   *        在调用线程中以成功调用回调；否则放入发送队列，由读取线程在对端读取以后写入
+   *
+   * @param data 需要发送的数据
+   * @param call_back 发送完成的回调
+   */
+  void send(std::string data,
+            std::function<void(const std::error_code &)> call_back);
+
+  /**
+   * @brief 关闭链接并通知对端，等待读取线程退出。发送队列中还没有发送的数据
+   *        以 asio::error::operation_aborted 在调用线程中调用回调。
+   *        不会调用 start 传入的回调
+   *
+   */
+  void disconnect();
+
+  /**
+   * @brief 请求断开链接，可以在任意线程中调用。读取线程关闭链接以后以
+   *        error_code::require_disconnecet 调用 start 传入的回调
+   *
+   */
+  void close();
+
+  /**
+   * @brief 设置发送队列的配置，只有 max_bytes 生效，需要在 send 之前调用
+   *
+   * @param policy 发送队列配置
+   */
+  inline void set_send_buffer_policy(const send_buffer_policy &policy) {
+    send_buffer_policy_ = policy;
+  }
+
+  /**
+   * @brief 设置读取线程没有数据时，在 futex 上等待之前空转的次数，需要在 start
+   *        之前调用。越大延迟越低，空闲时占用的 CPU 越多。
+   *        默认为2000，只有一个 CPU 时默认为0
+   *
+   * @param spin_count 空转的次数
+   */
+  inline void set_spin_count(uint32_t spin_count) { spin_count_ = spin_count; }
+
+  inline std::size_t pending_send_bytes() const {
+    return pending_send_bytes_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 获取链接对应的 connection_handle，链接创建时生成，整个生命周期内不变
+   *
+   * @return const std::shared_ptr<connection_handle>& 链接对应的 handle
+   */
+  inline const std::shared_ptr<connection_handle> &get_handle() const {
+    return handle_;
+  }
+
+private:
+  struct side_state;
+  struct control_block;
+
+  shm_connection(std::string name, bool owner, void *region,
+                 std::size_t region_size,
+                 base_packet_assemble *packet_assemble);
+
+  void _run();
+
+  bool _read();
+
+  bool _flush();
+
+  void _close(const std::error_code &error_code);
+
+  void _notify_peer();
+
+  void _wake(side_state &side);
+
+  side_state &_self();
+
+  side_state &_peer();
+
+private:
+  const std::string name_;
+  const bool owner_;
+  void *region_;
+  const std::size_t region_size_;
+  control_block *control_;
+  shm_ring read_ring_;
+  shm_ring write_ring_;
+  std::unique_ptr<base_packet_assemble> packet_assemble_;
+  std::shared_ptr<connection_handle> handle_;
+  std::function<void(const std::error_code &)> disconnect_callback_;
+  send_buffer_policy send_buffer_policy_;
+  uint32_t spin_count_{2000};
+  std::atomic<std::size_t> pending_send_bytes_{0};
+  // 保护 send_items_ 和 send_offset_，以及对 write_ring_ 的写入
+  std::mutex send_mutex_;
+  std::deque<std::pair<std::string /* data */,
+                       std::function<void(const std::error_code &)>>>
+      send_items_;
+  // 发送队列第一个数据已经写入的字节数
+  std::size_t send_offset_{0};
+  std::atomic<bool> stopped_{false};
+  std::atomic<bool> close_requested_{false};
+  std::thread thread_;
+};
+
+/**
+ * @brief shm_connection 对应的 connection_handle，不会延长链接的生命周期
+ *
+ */
+class shm_connection_handle : public connection_handle {
+public:
+  explicit shm_connection_handle(
+      const std::shared_ptr<shm_connection> &connection)
+      : connection_(connection) {}
+
+  void send(std::string data,
+            std::function<void(const std::error_code &)> call_back) override;
+  std::size_t pending_send_bytes() const override;
+  void close() override;
+  ~shm_connection_handle() override = default;
+
+private:
+  std::weak_ptr<shm_connection> connection_;
+};
+
+} // namespace salt
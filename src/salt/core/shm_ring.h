@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+namespace salt {
+
+/**
+ * @brief shm_ring 放在共享内存开头的控制信息，读写位置只增不减，
+ *        对 capacity 取模得到在数据区中的偏移
+ *
+ */
+struct shm_ring_header {
+  /**
+   * @brief 写入位置，只由写入方修改
+   *
+   */
+  alignas(64) std::atomic<uint64_t> head{0};
+
+  /**
+   * @brief 读取位置，只由读取方修改
+   *
+   */
+  alignas(64) std::atomic<uint64_t> tail{0};
+
+  alignas(64) uint64_t capacity{0};
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shm_ring requires lock free 64 bit atomic");
+
+/**
+ * @brief 单生产者单消费者的字节环形缓冲区，控制信息和数据都放在调用者提供的内存中，
+ *        可以放在共享内存里由两个进程分别读写。写入方和读取方各自只能有一个线程
+ *
+ */
+class shm_ring {
+public:
+  /**
+   * @brief 计算容量为 capacity 的环形缓冲区需要的内存大小
+   *
+   * @param capacity 数据区大小，需要是2的幂
+   * @return std::size_t 需要的内存大小，包括控制信息
+   */
+  static constexpr std::size_t region_size(std::size_t capacity) {
+    return sizeof(shm_ring_header) + capacity;
+  }
+
+  /**
+   * @brief 在 memory 上初始化环形缓冲区，只能由创建共享内存的一方调用一次
+   *
+   * @param memory 按照64字节对齐，大小至少为 region_size(capacity) 的内存
+   * @param capacity 数据区大小，需要是2的幂
+   */
+  static void init(void *memory, std::size_t capacity) {
+    auto header = new (memory) shm_ring_header;
+    header->capacity = capacity;
+  }
+
+  /**
+   * @brief 使用已经初始化的环形缓冲区
+   *
+   * @param memory 调用过 init 的内存
+   */
+  explicit shm_ring(void *memory)
+      : header_(static_cast<shm_ring_header *>(memory)),
+        data_(static_cast<char *>(memory) + sizeof(shm_ring_header)),
+        mask_(header_->capacity - 1) {}
+
+  inline std::size_t capacity() const { return mask_ + 1; }
+
+  /**
+   * @brief 获取可以读取的字节数，读取方调用
+   *
+   * @return std::size_t 可以读取的字节数
+   */
+  inline std::size_t readable() const {
+    return header_->head.load(std::memory_order_acquire) -
+           header_->tail.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 获取可以写入的字节数，写入方调用
+   *
+   * @return std::size_t 可以写入的字节数
+   */
+  inline std::size_t writable() const {
+    return capacity() - (header_->head.load(std::memory_order_relaxed) -
+                         header_->tail.load(std::memory_order_acquire));
+  }
+
+  /**
+   * @brief 尽可能多地写入数据，写入方调用
+   *
+   * @param data 需要写入的数据
+   * @return std::size_t 实际写入的字节数，缓冲区满时为0
+   */
+  std::size_t write_some(std::string_view data) {
+    auto size = std::min(data.size(), writable());
+    if (size == 0) {
+      return 0;
+    }
+
+    auto head = header_->head.load(std::memory_order_relaxed);
+    auto offset = static_cast<std::size_t>(head & mask_);
+    auto first = std::min(size, capacity() - offset);
+    std::memcpy(data_ + offset, data.data(), first);
+    std::memcpy(data_, data.data() + first, size - first);
+    header_->head.store(head + size, std::memory_order_release);
+    return size;
+  }
+
+  /**
+   * @brief 获取可以读取的数据中连续的一段，读取方调用。数据回绕时只返回到数据区末尾的部分，
+   *        consume 以后再次调用获取剩下的部分
+   *
+   * @return std::string_view 指向数据区的数据，consume 之前有效
+   */
+  std::string_view peek() const {
+    auto size = readable();
+    auto offset =
+        static_cast<std::size_t>(header_->tail.load(std::memory_order_relaxed) &
+                                 mask_);
+    return std::string_view{data_ + offset,
+                            std::min(size, capacity() - offset)};
+  }
+
+  /**
+   * @brief 标记 size 字节的数据已经读取，写入方可以覆盖这部分空间，读取方调用
+   *
+   * @param size 已经读取的字节数，不能超过 readable()
+   */
+  inline void consume(std::size_t size) {
+    header_->tail.store(header_->tail.load(std::memory_order_relaxed) + size,
+                        std::memory_order_release);
+  }
+
+private:
+  shm_ring_header *header_;
+  char *data_;
+  std::size_t mask_;
+};
+
+} // namespace salt
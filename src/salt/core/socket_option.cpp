@@ -0,0 +1,158 @@
+#include "salt/core/socket_option.h"
+
+#include "salt/core/error.h"
+#include "salt/core/log.h"
+
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
+
+namespace salt {
+
+#ifdef TCP_QUICKACK
+using quick_ack_option =
+    asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>;
+#endif
+
+#ifdef TCP_DEFER_ACCEPT
+using defer_accept_option =
+    asio::detail::socket_option::integer<IPPROTO_TCP, TCP_DEFER_ACCEPT>;
+#endif
+
+#ifdef SO_BUSY_POLL
+using busy_poll_option =
+    asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+
+template <typename socket_type>
+static std::error_code apply_buffer_size(socket_type &socket,
+                                         const socket_option &option) {
+  std::error_code err_code;
+  if (option.send_buffer_size) {
+    socket.set_option(asio::socket_base::send_buffer_size(
+                          option.send_buffer_size.value()),
+                      err_code);
+    if (err_code) {
+      log_error("set SO_SNDBUF error, reason:%s", err_code.message().c_str());
+      return err_code;
+    }
+  }
+  if (option.receive_buffer_size) {
+    socket.set_option(asio::socket_base::receive_buffer_size(
+                          option.receive_buffer_size.value()),
+                      err_code);
+    if (err_code) {
+      log_error("set SO_RCVBUF error, reason:%s", err_code.message().c_str());
+      return err_code;
+    }
+  }
+  return make_error_code(error_code::success);
+}
+
+template <typename socket_type>
+static std::error_code apply_busy_poll(socket_type &socket,
+                                       const socket_option &option) {
+  if (!option.busy_poll_us) {
+    return make_error_code(error_code::success);
+  }
+#ifdef SO_BUSY_POLL
+  std::error_code err_code;
+  socket.set_option(busy_poll_option(option.busy_poll_us.value()), err_code);
+  if (err_code) {
+    log_error("set SO_BUSY_POLL error, reason:%s", err_code.message().c_str());
+  }
+  return err_code;
+#else
+  log_info("SO_BUSY_POLL is not supported, ignore");
+  return make_error_code(error_code::success);
+#endif
+}
+
+std::error_code apply_listen_option(stream_acceptor &acceptor,
+                                    const socket_option &option) {
+  auto err_code = apply_buffer_size(acceptor, option);
+  if (err_code) {
+    return err_code;
+  }
+
+  if (option.defer_accept_s) {
+#ifdef TCP_DEFER_ACCEPT
+    acceptor.set_option(defer_accept_option(option.defer_accept_s.value()),
+                        err_code);
+    if (err_code) {
+      log_error("set TCP_DEFER_ACCEPT error, reason:%s",
+                err_code.message().c_str());
+      return err_code;
+    }
+#else
+    log_info("TCP_DEFER_ACCEPT is not supported, ignore");
+#endif
+  }
+  return make_error_code(error_code::success);
+}
+
+std::error_code apply_pre_connect_option(stream_socket &socket,
+                                         const socket_option &option) {
+  auto err_code = apply_buffer_size(socket, option);
+  if (err_code) {
+    return err_code;
+  }
+
+  if (option.no_delay) {
+    socket.set_option(asio::ip::tcp::no_delay(option.no_delay.value()),
+                      err_code);
+    if (err_code) {
+      log_error("set TCP_NODELAY error, reason:%s",
+                err_code.message().c_str());
+      return err_code;
+    }
+  }
+
+  return apply_busy_poll(socket, option);
+}
+
+std::error_code apply_connected_option(stream_socket &socket,
+                                       const socket_option &option) {
+  std::error_code err_code;
+  if (option.no_delay) {
+    socket.set_option(asio::ip::tcp::no_delay(option.no_delay.value()),
+                      err_code);
+    if (err_code) {
+      log_error("set TCP_NODELAY error, reason:%s",
+                err_code.message().c_str());
+      return err_code;
+    }
+  }
+
+  if (option.quick_ack.value_or(false)) {
+    err_code = apply_quick_ack(socket);
+    if (err_code) {
+      return err_code;
+    }
+  }
+
+  return apply_busy_poll(socket, option);
+}
+
+std::error_code apply_quick_ack(stream_socket &socket) {
+#ifdef TCP_QUICKACK
+  std::error_code err_code;
+  socket.set_option(quick_ack_option(true), err_code);
+  if (err_code) {
+    log_error("set TCP_QUICKACK error, reason:%s", err_code.message().c_str());
+  }
+  return err_code;
+#else
+  return make_error_code(error_code::success);
+#endif
+}
+
+socket_option local_socket_option(const socket_option &option) {
+  socket_option result;
+  result.send_buffer_size = option.send_buffer_size;
+  result.receive_buffer_size = option.receive_buffer_size;
+  result.listen_backlog = option.listen_backlog;
+  return result;
+}
+
+} // namespace salt
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <optional>
+#include <system_error>
+
+#include "asio.hpp"
+
+#include "salt/core/stream_endpoint.h"
+
+namespace salt {
+
+/**
+ * @brief socket 选项，没有设置的选项保持系统默认值。
+ *        salt 会在合适的时机设置这些选项：服务器端在 listen 之前和 accept
+ *        之后，开始读取数据之前；客户端在 connect 之前和 connect 之后
+ *
+ */
+struct socket_option {
+  /**
+   * @brief TCP_NODELAY，设置为 true 时关闭 Nagle 算法
+   *
+   */
+  std::optional<bool> no_delay;
+
+  /**
+   * @brief SO_SNDBUF，内核发送缓冲区大小，单位 byte
+   *
+   */
+  std::optional<int> send_buffer_size;
+
+  /**
+   * @brief SO_RCVBUF，内核接收缓冲区大小，单位 byte。
+   *        需要在建立链接之前设置才能影响 tcp 窗口扩大因子，
+   *        服务器端会设置在监听 socket 上由新链接继承
+   *
+   */
+  std::optional<int> receive_buffer_size;
+
+  /**
+   * @brief TCP_QUICKACK，仅 linux 有效。设置为 true 时关闭延迟确认。
+   *        内核会自动清除这个选项，所以 salt 会在每次读取数据以后重新设置
+   *
+   */
+  std::optional<bool> quick_ack;
+
+  /**
+   * @brief TCP_DEFER_ACCEPT，仅 linux 服务器端有效，单位秒。
+   *        新链接在收到数据以后才会被 accept
+   *
+   */
+  std::optional<int> defer_accept_s;
+
+  /**
+   * @brief SO_BUSY_POLL，仅 linux 有效，单位微秒。读取数据时忙等网卡的时间
+   *
+   */
+  std::optional<int> busy_poll_us;
+
+  /**
+   * @brief listen 的 backlog，仅服务器端有效
+   *
+   */
+  int listen_backlog{asio::socket_base::max_listen_connections};
+};
+
+/**
+ * @brief 设置监听 socket 的选项，在 listen 之前调用
+ *
+ * @param acceptor 监听 socket，需要已经 open
+ * @param option socket 选项
+ * @return std::error_code 设置结果
+ */
+std::error_code apply_listen_option(stream_acceptor &acceptor,
+                                    const socket_option &option);
+
+/**
+ * @brief 设置 connect 之前需要设置的选项
+ *
+ * @param socket 需要设置的 socket，需要已经 open
+ * @param option socket 选项
+ * @return std::error_code 设置结果
+ */
+std::error_code apply_pre_connect_option(stream_socket &socket,
+                                         const socket_option &option);
+
+/**
+ * @brief 设置链接建立以后需要设置的选项，在 accept 或者 connect 完成之后，
+ *        开始读取数据之前调用
+ *
+ * @param socket 已经建立链接的 socket
+ * @param option socket 选项
+ * @return std::error_code 设置结果
+ */
+std::error_code apply_connected_option(stream_socket &socket,
+                                       const socket_option &option);
+
+/**
+ * @brief 重新设置 TCP_QUICKACK，不支持的平台上什么都不做
+ *
+ * @param socket 已经建立链接的 socket
+ * @return std::error_code 设置结果
+ */
+std::error_code apply_quick_ack(stream_socket &socket);
+
+/**
+ * @brief 去掉只对 tcp 有效的选项，只保留 SO_SNDBUF、SO_RCVBUF 和 backlog，
+ *        用于 unix domain socket
+ *
+ * @param option socket 选项
+ * @return socket_option 去掉 tcp 选项以后的 socket 选项
+ */
+socket_option local_socket_option(const socket_option &option);
+
+} // namespace salt
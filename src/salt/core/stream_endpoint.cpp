@@ -0,0 +1,70 @@
+#include "salt/core/stream_endpoint.h"
+
+#include <cstring>
+
+namespace salt {
+
+/**
+ * @brief 把 stream_endpoint 中的 sockaddr 复制到具体协议的地址中
+ *
+ */
+template <typename endpoint_type>
+static endpoint_type to_endpoint(const stream_endpoint &endpoint) {
+  endpoint_type result;
+  if (endpoint.size() > result.capacity()) {
+    return result;
+  }
+  std::memcpy(result.data(), endpoint.data(), endpoint.size());
+  result.resize(endpoint.size());
+  return result;
+}
+
+stream_endpoint make_local_endpoint(const std::string &path,
+                                    std::error_code &error_code) {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+  try {
+    error_code.clear();
+    return stream_endpoint{asio::local::stream_protocol::endpoint{path}};
+  } catch (const std::system_error &e) {
+    // 路径超过 sockaddr_un::sun_path 的长度
+    error_code = e.code();
+    return stream_endpoint{};
+  }
+#else
+  error_code =
+      asio::error::make_error_code(asio::error::operation_not_supported);
+  return stream_endpoint{};
+#endif
+}
+
+bool is_local_endpoint(const stream_endpoint &endpoint) {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+  return endpoint.protocol().family() == AF_UNIX;
+#else
+  return false;
+#endif
+}
+
+std::string endpoint_address(const stream_endpoint &endpoint) {
+  auto family = endpoint.protocol().family();
+  if (family == AF_INET || family == AF_INET6) {
+    return to_endpoint<asio::ip::tcp::endpoint>(endpoint).address().to_string();
+  }
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+  if (family == AF_UNIX) {
+    return to_endpoint<asio::local::stream_protocol::endpoint>(endpoint)
+        .path();
+  }
+#endif
+  return std::string{};
+}
+
+uint16_t endpoint_port(const stream_endpoint &endpoint) {
+  auto family = endpoint.protocol().family();
+  if (family == AF_INET || family == AF_INET6) {
+    return to_endpoint<asio::ip::tcp::endpoint>(endpoint).port();
+  }
+  return 0;
+}
+
+} // namespace salt
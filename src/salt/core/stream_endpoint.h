@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include "asio.hpp"
+
+namespace salt {
+
+/**
+ * @brief 链接使用的 socket 类型，可以是 tcp socket，也可以是 unix domain socket
+ *
+ */
+using stream_socket = asio::generic::stream_protocol::socket;
+
+/**
+ * @brief 与 stream_socket 对应的地址类型
+ *
+ */
+using stream_endpoint = asio::generic::stream_protocol::endpoint;
+
+/**
+ * @brief 监听 stream_endpoint 的 socket 类型
+ *
+ */
+using stream_acceptor =
+    asio::basic_socket_acceptor<asio::generic::stream_protocol>;
+
+/**
+ * @brief 创建 unix domain socket 地址
+ *
+ * @param path socket 文件路径
+ * @param error_code 平台不支持 unix domain socket 或者路径过长时返回错误
+ * @return stream_endpoint 创建的地址
+ */
+stream_endpoint make_local_endpoint(const std::string &path,
+                                    std::error_code &error_code);
+
+/**
+ * @brief 判断地址是否是 unix domain socket 地址
+ *
+ * @param endpoint 地址
+ * @return true 是 unix domain socket 地址
+ * @return false 不是 unix domain socket 地址
+ */
+bool is_local_endpoint(const stream_endpoint &endpoint);
+
+/**
+ * @brief 获取地址的字符串表示。ip 地址返回 ip，unix domain socket
+ *        地址返回 socket 文件路径，未命名的 unix domain socket 返回空字符串
+ *
+ * @param endpoint 地址
+ * @return std::string 地址的字符串表示
+ */
+std::string endpoint_address(const stream_endpoint &endpoint);
+
+/**
+ * @brief 获取地址的端口，unix domain socket 地址返回0
+ *
+ * @param endpoint 地址
+ * @return uint16_t 端口
+ */
+uint16_t endpoint_port(const stream_endpoint &endpoint);
+
+} // namespace salt
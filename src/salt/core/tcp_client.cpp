@@ -1,9 +1,15 @@
 #include "salt/core/tcp_client.h"
 
+#include <algorithm>
 #include <chrono>
+#include <future>
+#include <limits>
 
+#include "salt/core/drain_context.h"
 #include "salt/core/error.h"
+#include "salt/core/io_backend.h"
 #include "salt/core/log.h"
+#include "salt/core/socket_option.h"
 #include "salt/util/call_back_wrapper.h"
 
 namespace salt {
@@ -11,15 +17,30 @@ namespace salt {
 tcp_client::~tcp_client() { stop(); }
 
 void tcp_client::stop() {
+  reconnect_wheel_->stop();
   control_thread_.stop();
+  if (timing_wheel_) {
+    timing_wheel_->stop();
+  }
   transfer_io_context_.stop();
-  connected_.clear();
-  all_.clear();
+  connections_.clear();
+  waiting_connects_.clear();
+  connecting_count_ = 0;
+  std::atomic_store(&address_index_, std::make_shared<const address_index>());
+  {
+    std::lock_guard<std::mutex> lock(service_mutex_);
+    std::atomic_store(&services_, std::make_shared<const service_table>());
+  }
 }
 
 tcp_client::tcp_client()
     : transfer_io_context_work_guard_(transfer_io_context_.get_executor()),
-      resolver_(control_thread_.get_io_context()) {}
+      resolve_cache_(control_thread_.get_io_context()),
+      reconnect_wheel_(io_timing_wheel::create(control_thread_.get_io_context(),
+                                               std::chrono::milliseconds{20},
+                                               1024)) {
+  reconnect_wheel_->start();
+}
 
 void tcp_client::init(uint32_t transfer_thread_count) {
   if (transfer_thread_count == 0) {
@@ -32,44 +53,81 @@ void tcp_client::init(uint32_t transfer_thread_count) {
   }
 }
 
-void tcp_client::connect(std::string address_v4, uint16_t port,
-                         const connection_meta &meta) {
+uint64_t tcp_client::connect(std::string address_v4, uint16_t port,
+                             const connection_meta &meta) {
+  return _add_connection(std::move(address_v4), port, meta, false);
+}
+
+uint64_t tcp_client::connect_unix(std::string path,
+                                  const connection_meta &meta) {
+  return _add_connection(std::move(path), 0, meta, true);
+}
+
+uint64_t tcp_client::connect_unix(std::string path) {
+  connection_meta meta;
+  meta.retry_when_connection_error = false;
+  return connect_unix(std::move(path), meta);
+}
+
+uint64_t tcp_client::_add_connection(std::string address, uint16_t port,
+                                     const connection_meta &meta,
+                                     bool local) {
   if (!assemble_creator_ && !meta.assemble_creator) {
     notify_disconnected(make_error_code(error_code::assemble_creator_not_set),
-                        address_v4, port);
-    return;
+                        address, port);
+    return 0;
   }
 
-  connection_meta_impl meta_impl{meta, 0};
+  auto connection_id = next_connection_id_++;
   control_thread_.get_io_context().post(
-      [this, meta_impl, address_v4 = std::move(address_v4), port] {
-        if (meta_impl.meta_.retry_when_connection_error &&
-            (meta_impl.meta_.retry_forever ||
-             (!meta_impl.meta_.retry_forever &&
-              meta_impl.meta_.max_retry_cnt > 0))) {
-          connection_metas_[{address_v4, port}] = meta_impl;
-        }
-        _connect(std::move(address_v4), port);
+      [this, connection_id, meta, address = std::move(address), port,
+       local]() mutable {
+        // 即使不重连，也需要保存 meta，建立链接时会用到拆包器工厂和接收缓冲区配置
+        connection_slot slot;
+        slot.address = {std::move(address), port};
+        slot.local = local;
+        slot.meta = std::move(meta);
+        _index_address(slot.address.host, slot.address.port, connection_id);
+        connections_.insert(connection_id, std::move(slot));
+        _connect(connection_id);
       });
+  return connection_id;
 }
 
-void tcp_client::connect(std::string address_v4, uint16_t port) {
-  if (!assemble_creator_) {
-    notify_disconnected(make_error_code(error_code::assemble_creator_not_set),
-                        address_v4, port);
+uint64_t tcp_client::connect(std::string address_v4, uint16_t port) {
+  connection_meta meta;
+  meta.retry_when_connection_error = false;
+  return connect(std::move(address_v4), port, meta);
+}
+
+void tcp_client::_connect(uint64_t connection_id) {
+  auto slot = connections_.find(connection_id);
+  if (!slot) {
+    return;
+  }
+
+  auto address_v4 = slot->address.host;
+  auto port = slot->address.port;
+  if (draining_) {
+    log_debug("client is draining, ignore connect to %s:%u",
+              address_v4.c_str(), port);
+    _remove_connection(connection_id);
+    notify_dropped(address_v4, port);
+    return;
+  }
+
+  if (max_concurrent_connects_ != 0 &&
+      connecting_count_ >= max_concurrent_connects_) {
+    log_debug("too many connects in progress, %s:%u wait", address_v4.c_str(),
+              port);
+    waiting_connects_.push_back(connection_id);
     return;
   }
-  control_thread_.get_io_context().post(
-      [this, address_v4 = std::move(address_v4), port]() {
-        _connect(std::move(address_v4), port);
-      });
-}
 
-void tcp_client::_connect(std::string address_v4, uint16_t port) {
   salt::base_packet_assemble *assemble = nullptr;
-  if (auto pos = connection_metas_.find({address_v4, port});
-      pos != connection_metas_.end() && pos->second.meta_.assemble_creator) {
-    assemble = pos->second.meta_.assemble_creator();
+  const auto &meta = slot->meta;
+  if (meta.assemble_creator) {
+    assemble = meta.assemble_creator();
   } else {
     assemble = assemble_creator_();
   }
@@ -78,95 +136,347 @@ void tcp_client::_connect(std::string address_v4, uint16_t port) {
     notify_disconnected(
         make_error_code(error_code::assemble_create_reutrn_nullptr), address_v4,
         port);
+    _remove_connection(connection_id);
     return;
   }
 
+  auto attempt = ++(slot->attempt);
   auto connection = tcp_connection::create(
       transfer_io_context_, assemble,
-      [this](const std::string &remote_addr, uint16_t port,
-             const std::error_code &error_code) {
-        this->handle_connection_error(remote_addr, port, error_code);
-      });
+      [this, connection_id, attempt](const std::string &, uint16_t,
+                                     const std::error_code &error_code) {
+        this->handle_connection_error(connection_id, attempt, error_code);
+      },
+      false, connection_id);
 
   if (!connection) {
     notify_disconnected(make_error_code(error_code::internel_error), address_v4,
                         port);
+    _remove_connection(connection_id);
     return;
   }
 
+  connection->set_receive_buffer_policy(meta.receive_buffer);
+  connection->set_send_batch_max_bytes(meta.send_batch_max_bytes);
+  connection->set_send_buffer_policy(meta.send_buffer);
+  if (meta.heartbeat.enabled()) {
+    // 所有链接共用一个时间轮，只在控制线程中创建
+    if (!timing_wheel_) {
+      timing_wheel_ = io_timing_wheel::create(transfer_io_context_);
+      timing_wheel_->start();
+    }
+    connection->set_heartbeat(timing_wheel_, meta.heartbeat);
+  }
+  connection->set_write_state_callback(
+      [this, address_v4, port](bool congested) {
+        notify_write_state(address_v4, port, congested);
+      });
   connection->set_remote_address(address_v4);
   connection->set_remote_port(port);
-  all_[{address_v4, port}] = connection;
-  resolver_.async_resolve(
-      address_v4, std::to_string(port),
-      asio::ip::tcp::resolver::numeric_service,
-      [this, connection = std::move(connection), address_v4,
-       port](const std::error_code &err_code,
-             asio::ip::tcp::resolver::results_type result) {
+  slot->connection = connection;
+  slot->connecting = true;
+  ++connecting_count_;
+  auto context = std::make_shared<connect_context>();
+  context->connection = std::move(connection);
+  context->connection_id = connection_id;
+  context->address_v4 = address_v4;
+  context->port = port;
+  context->option = meta.socket;
+  context->connect_timeout = meta.connect_timeout;
+  context->attempt_delay = meta.connection_attempt_delay;
+  if (slot->local) {
+    std::error_code err_code;
+    auto endpoint = make_local_endpoint(address_v4, err_code);
+    if (err_code) {
+      context->connection->handle_fail_connection(err_code);
+      return;
+    }
+
+    context->option = local_socket_option(meta.socket);
+    context->endpoints.push_back(endpoint);
+    _start_connect_attempt(context);
+    return;
+  }
+
+  resolve_cache_.async_resolve(
+      address_v4, port,
+      [this, context](const std::error_code &err_code,
+                      resolve_cache::endpoints result) {
         if (err_code) {
-          connection->handle_fail_connection(err_code);
+          context->connection->handle_fail_connection(err_code);
           return;
         }
 
-        asio::async_connect(
-            connection->get_socket(), result,
-            [this, address_v4 = std::move(address_v4), port,
-             connection = std::move(connection)](
-                const std::error_code &error_code,
-                const asio::ip::tcp::endpoint &endpoint) {
-              if (!error_code) {
-                log_debug("connected to host:%s:%u",
-                          endpoint.address().to_string().c_str(),
-                          endpoint.port());
-                connection->set_remote_address(endpoint.address().to_string());
-                connection->set_remote_port(endpoint.port());
-                {
-                  std::error_code error_code;
-                  const auto &local_endpoint =
-                      connection->get_socket().local_endpoint(error_code);
-                  if (!error_code) {
-                    connection->set_local_address(
-                        local_endpoint.address().to_string());
-                    connection->set_local_port(local_endpoint.port());
-                  }
-                }
-
-                control_thread_.get_io_context().post(
-                    [this, address_v4, port, connection]() {
-                      auto pos = connection_metas_.find({address_v4, port});
-                      if (pos != connection_metas_.end()) {
-                        pos->second.current_retry_cnt_ = 0;
-                      }
-                      connected_[{address_v4, port}] = connection;
-                      notify_connected(address_v4, port);
-                    });
-                connection->read();
-              } else {
-                connection->handle_fail_connection(error_code);
-              }
-            });
+        context->endpoints = _interleave_address_family(result);
+        _start_connect_attempt(context);
       });
 }
 
+std::vector<stream_endpoint> tcp_client::_interleave_address_family(
+    const resolve_cache::endpoints &result) {
+  std::vector<asio::ip::tcp::endpoint> v6;
+  std::vector<asio::ip::tcp::endpoint> v4;
+  for (const auto &endpoint : result) {
+    if (endpoint.address().is_v6()) {
+      v6.push_back(endpoint);
+    } else {
+      v4.push_back(endpoint);
+    }
+  }
+
+  std::vector<stream_endpoint> endpoints;
+  endpoints.reserve(v6.size() + v4.size());
+  for (std::size_t i = 0; i < std::max(v6.size(), v4.size()); ++i) {
+    if (i < v6.size()) {
+      endpoints.push_back(v6[i]);
+    }
+    if (i < v4.size()) {
+      endpoints.push_back(v4[i]);
+    }
+  }
+  return endpoints;
+}
+
+void tcp_client::_start_connect_attempt(
+    std::shared_ptr<connect_context> context) {
+  if (context->next_endpoint == context->endpoints.size()) {
+    if (context->attempts.empty()) {
+      context->finished = true;
+      context->connection->handle_fail_connection(
+          context->last_error ? context->last_error
+                              : asio::error::make_error_code(
+                                    asio::error::host_not_found));
+    }
+    return;
+  }
+
+  auto attempt = std::make_shared<connect_attempt>(transfer_io_context_);
+  attempt->endpoint = context->endpoints[context->next_endpoint++];
+  auto &socket = attempt->socket;
+  std::error_code err_code;
+  socket.open(attempt->endpoint.protocol(), err_code);
+  if (!err_code) {
+    err_code = apply_pre_connect_option(socket, context->option);
+  }
+  if (err_code) {
+    context->last_error = err_code;
+    _start_connect_attempt(std::move(context));
+    return;
+  }
+
+  context->attempts.push_back(attempt);
+  if (context->connect_timeout.count() > 0) {
+    attempt->timeout_timer =
+        reconnect_wheel_->add(context->connect_timeout, [attempt] {
+          // 关闭 socket 以后 async_connect 以 operation_aborted 完成
+          attempt->timeout_timer = 0;
+          attempt->timed_out = true;
+          std::error_code error_code;
+          attempt->socket.close(error_code);
+        });
+  }
+  // 完成回调在控制线程中执行，与定时器、其它地址的连接串行
+  socket.async_connect(
+      attempt->endpoint,
+      asio::bind_executor(
+          control_thread_.get_io_context(),
+          [this, context, attempt](const std::error_code &error_code) {
+            _handle_connect_attempt(context, attempt, error_code);
+          }));
+
+  if (context->attempt_delay.count() > 0 &&
+      context->next_endpoint < context->endpoints.size()) {
+    context->attempt_delay_timer =
+        reconnect_wheel_->add(context->attempt_delay, [this, context] {
+          context->attempt_delay_timer = 0;
+          if (!context->finished) {
+            _start_connect_attempt(context);
+          }
+        });
+  }
+}
+
+void tcp_client::_handle_connect_attempt(
+    std::shared_ptr<connect_context> context,
+    std::shared_ptr<connect_attempt> attempt, std::error_code error_code) {
+  if (attempt->timeout_timer != 0) {
+    reconnect_wheel_->cancel(attempt->timeout_timer);
+    attempt->timeout_timer = 0;
+  }
+  auto &attempts = context->attempts;
+  attempts.erase(std::remove(attempts.begin(), attempts.end(), attempt),
+                 attempts.end());
+  if (context->finished) {
+    // 其它地址已经连接成功
+    std::error_code ignore;
+    attempt->socket.close(ignore);
+    return;
+  }
+
+  if (!error_code) {
+    _connect_succeeded(std::move(context), std::move(attempt));
+    return;
+  }
+
+  if (attempt->timed_out) {
+    error_code = asio::error::make_error_code(asio::error::timed_out);
+  }
+  log_debug("connect to %s:%u error, reason:%s",
+            endpoint_address(attempt->endpoint).c_str(),
+            endpoint_port(attempt->endpoint), error_code.message().c_str());
+  context->last_error = error_code;
+  if (context->attempt_delay_timer != 0) {
+    // 一个地址失败以后不再等待，立即开始下一个地址
+    reconnect_wheel_->cancel(context->attempt_delay_timer);
+    context->attempt_delay_timer = 0;
+    _start_connect_attempt(std::move(context));
+  } else if (context->attempt_delay.count() == 0 || attempts.empty()) {
+    _start_connect_attempt(std::move(context));
+  }
+}
+
+void tcp_client::_connect_succeeded(std::shared_ptr<connect_context> context,
+                                    std::shared_ptr<connect_attempt> attempt) {
+  context->finished = true;
+  if (context->attempt_delay_timer != 0) {
+    reconnect_wheel_->cancel(context->attempt_delay_timer);
+    context->attempt_delay_timer = 0;
+  }
+  for (auto &other : context->attempts) {
+    std::error_code ignore;
+    other->socket.close(ignore);
+  }
+
+  auto &connection = context->connection;
+  const auto &endpoint = attempt->endpoint;
+  log_debug("connected to host:%s:%u", endpoint_address(endpoint).c_str(),
+            endpoint_port(endpoint));
+  connection->get_socket() = std::move(attempt->socket);
+  connection->set_remote_address(endpoint_address(endpoint));
+  connection->set_remote_port(endpoint_port(endpoint));
+  {
+    std::error_code error_code;
+    const auto &local_endpoint =
+        connection->get_socket().local_endpoint(error_code);
+    if (!error_code) {
+      connection->set_local_address(endpoint_address(local_endpoint));
+      connection->set_local_port(endpoint_port(local_endpoint));
+    }
+  }
+  apply_connected_option(connection->get_socket(), context->option);
+  connection->set_quick_ack(context->option.quick_ack.value_or(false));
+
+  auto connection_id = context->connection_id;
+  auto slot = connections_.find(connection_id);
+  if (!slot || slot->connection != connection) {
+    // 链接建立之前已经调用了 disconnect
+    connection->disconnect();
+    return;
+  }
+  connection->start_heartbeat();
+  slot->current_retry_cnt = 0;
+  slot->connected = true;
+  connected_.add(connection_id, connection);
+  connected_version_.fetch_add(1, std::memory_order_release);
+  notify_connected(slot->address.host, slot->address.port);
+  _release_connect(connection_id);
+  connection->read();
+}
+
 void tcp_client::disconnect(std::string address_v4, uint16_t port) {
   notify_disconnected(make_error_code(error_code::call_disconnect), address_v4,
                       port);
   control_thread_.get_io_context().post(
       [this, address_v4 = std::move(address_v4), port] {
-        _disconnect(std::move(address_v4), port);
+        _disconnect(_find_connection_id(address_v4, port));
       });
 }
 
-void tcp_client::_disconnect(std::string address_v4, uint16_t port) {
+void tcp_client::disconnect(uint64_t connection_id) {
+  control_thread_.get_io_context().post([this, connection_id] {
+    if (auto slot = connections_.find(connection_id); slot) {
+      notify_disconnected(make_error_code(error_code::call_disconnect),
+                          slot->address.host, slot->address.port);
+      _disconnect(connection_id);
+    }
+  });
+}
+
+void tcp_client::_disconnect(uint64_t connection_id) {
+  auto slot = connections_.find(connection_id);
+  if (!slot) {
+    return;
+  }
+
+  if (slot->connection) {
+    slot->connection->disconnect();
+  }
+  _remove_connection(connection_id);
+}
+
+void tcp_client::_remove_connection(uint64_t connection_id) {
+  auto slot = connections_.find(connection_id);
+  if (!slot) {
+    return;
+  }
+
+  _release_connect(connection_id);
+  connected_.remove(connection_id);
+  connected_version_.fetch_add(1, std::memory_order_release);
+  _unindex_address(slot->address.host, slot->address.port, connection_id);
+  connections_.erase(connection_id);
+}
+
+void tcp_client::_release_connect(uint64_t connection_id) {
+  auto slot = connections_.find(connection_id);
+  if (!slot || !slot->connecting) {
+    return;
+  }
+
+  slot->connecting = false;
+  --connecting_count_;
+  if (!waiting_connects_.empty()) {
+    // 调用方可能还持有 slot 的指针，_connect 可能删除 slot，所以不能在这里直接调用
+    control_thread_.get_io_context().post(
+        [this] { _admit_waiting_connects(); });
+  }
+}
 
-  if (auto pos = connected_.find({address_v4, port}); pos != connected_.end()) {
-    pos->second->disconnect();
-    connected_.erase(pos);
+void tcp_client::_admit_waiting_connects() {
+  while (!waiting_connects_.empty() &&
+         (max_concurrent_connects_ == 0 ||
+          connecting_count_ < max_concurrent_connects_)) {
+    auto connection_id = waiting_connects_.front();
+    waiting_connects_.pop_front();
+    _connect(connection_id);
   }
+}
 
-  if (auto pos = all_.find({address_v4, port}); pos != all_.end()) {
-    all_.erase(pos);
+uint64_t tcp_client::_find_connection_id(const std::string &address_v4,
+                                         uint16_t port) const {
+  auto index = std::atomic_load(&address_index_);
+  auto pos = index->find({address_v4, port});
+  return pos == index->end() ? 0 : pos->second;
+}
+
+void tcp_client::_index_address(const std::string &address_v4, uint16_t port,
+                                uint64_t connection_id) {
+  auto index = std::make_shared<address_index>(*address_index_);
+  (*index)[{address_v4, port}] = connection_id;
+  std::atomic_store(&address_index_,
+                    std::shared_ptr<const address_index>(std::move(index)));
+}
+
+void tcp_client::_unindex_address(const std::string &address_v4,
+                                  uint16_t port, uint64_t connection_id) {
+  auto pos = address_index_->find({address_v4, port});
+  if (pos == address_index_->end() || pos->second != connection_id) {
+    return;
   }
+  auto index = std::make_shared<address_index>(*address_index_);
+  index->erase({address_v4, port});
+  std::atomic_store(&address_index_,
+                    std::shared_ptr<const address_index>(std::move(index)));
 }
 
 tcp_client &
@@ -181,6 +491,8 @@ tcp_client::set_transfer_thread_count(uint32_t transfer_thread_count) {
     return *this;
   }
 
+  log_info("tcp_client start %u transfer threads with %s io backend",
+           transfer_thread_count, io_backend_name(current_io_backend()));
   for (auto i = 0u; i < transfer_thread_count; ++i) {
     io_threads_.emplace_back(
         new shared_asio_io_context_thread(transfer_io_context_));
@@ -197,102 +509,220 @@ tcp_client &tcp_client::set_assemble_creator(
 
 void tcp_client::broadcast(
     std::string data, std::function<void(const std::error_code &)> call_back) {
-  control_thread_.get_io_context().post(
-      [this, data = std::move(data), call_back = std::move(call_back)] {
-        for (auto &connected : connected_) {
-          connected.second->send(data, call_back);
-        }
+  connected_.for_each(
+      [&data, &call_back](const std::shared_ptr<tcp_connection> &connection) {
+        connection->send(data, call_back);
       });
 }
 
 void tcp_client::send(std::string address_v4, uint16_t port, std::string data,
                       std::function<void(const std::error_code &)> call_back) {
-  control_thread_.get_io_context().post(
-      [this, address_v4 = std::move(address_v4), port, data = std::move(data),
-       call_back = std::move(call_back)]() {
-        _send(std::move(address_v4), port, std::move(data), call_back);
-      });
+  send(_find_connection_id(address_v4, port), std::move(data),
+       std::move(call_back));
+}
+
+void tcp_client::send(uint64_t connection_id, std::string data,
+                      std::function<void(const std::error_code &)> call_back) {
+  if (auto connection = connected_.find(connection_id); connection) {
+    connection->send(std::move(data), std::move(call_back));
+  } else {
+    call(call_back, make_error_code(error_code::not_connected));
+  }
+}
+
+void tcp_client::add_service(std::string service_name,
+                             const std::vector<service_endpoint> &endpoints,
+                             const service_meta &meta) {
+  auto new_service = std::make_shared<service>();
+  new_service->balancer = load_balancer::create(meta.policy);
+  for (const auto &endpoint : endpoints) {
+    for (auto i = 0u; i < meta.connections_per_endpoint; ++i) {
+      auto connection_id =
+          connect(endpoint.address_v4, endpoint.port, meta.connection);
+      if (connection_id != 0) {
+        new_service->connection_ids.push_back(connection_id);
+      }
+    }
+  }
+
+  std::shared_ptr<service> old_service;
+  {
+    std::lock_guard<std::mutex> lock(service_mutex_);
+    auto services =
+        std::make_shared<service_table>(*std::atomic_load(&services_));
+    auto &slot = (*services)[std::move(service_name)];
+    old_service = std::move(slot);
+    slot = std::move(new_service);
+    std::atomic_store(
+        &services_, std::shared_ptr<const service_table>(std::move(services)));
+  }
+
+  if (old_service) {
+    for (auto connection_id : old_service->connection_ids) {
+      disconnect(connection_id);
+    }
+  }
 }
 
-void tcp_client::_send(std::string address_v4, uint16_t port, std::string data,
-                       std::function<void(const std::error_code &)> call_back) {
+void tcp_client::remove_service(const std::string &service_name) {
+  std::shared_ptr<service> old_service;
+  {
+    std::lock_guard<std::mutex> lock(service_mutex_);
+    auto current = std::atomic_load(&services_);
+    auto pos = current->find(service_name);
+    if (pos == current->end()) {
+      return;
+    }
+    old_service = pos->second;
+    auto services = std::make_shared<service_table>(*current);
+    services->erase(service_name);
+    std::atomic_store(
+        &services_, std::shared_ptr<const service_table>(std::move(services)));
+  }
 
-  if (auto pos = connected_.find({std::move(address_v4), port});
-      pos == connected_.end()) {
+  for (auto connection_id : old_service->connection_ids) {
+    disconnect(connection_id);
+  }
+}
+
+void tcp_client::send(const std::string &service_name, std::string data,
+                      std::function<void(const std::error_code &)> call_back) {
+  auto services = std::atomic_load(&services_);
+  auto pos = services->find(service_name);
+  if (pos == services->end()) {
+    call(call_back, make_error_code(error_code::service_not_found));
+    return;
+  }
+
+  const auto &service = pos->second;
+  auto candidates = _service_candidates(*service);
+  auto selected = service->balancer->select(candidates->handles);
+  if (!selected) {
     call(call_back, make_error_code(error_code::not_connected));
-  } else {
-    pos->second->send(std::move(data), std::move(call_back));
+    return;
   }
+  selected->send(std::move(data), std::move(call_back));
 }
 
-void tcp_client::handle_connection_error(const std::string &remote_address,
-                                         uint16_t remote_port,
-                                         const std::error_code &error_code) {
-  control_thread_.get_io_context().post(
-      [this, address_v4 = remote_address, remote_port] {
-        _disconnect(std::move(address_v4), remote_port);
-      });
+std::shared_ptr<const tcp_client::candidate_list>
+tcp_client::_service_candidates(service &target) {
+  // 先读取版本再查找链接，查找过程中链接发生变化时，下一次发送会重新生成
+  auto version = connected_version_.load(std::memory_order_acquire);
+  auto candidates = std::atomic_load(&target.candidates);
+  if (candidates && candidates->version == version) {
+    return candidates;
+  }
 
-  notify_disconnected(error_code, remote_address, remote_port);
-  log_error("connection remote address %s:%u error, reason:%s, disconnect",
-            remote_address.c_str(), remote_port, error_code.message().c_str());
-
-  auto reconnect = [this, remote_address, remote_port](uint32_t wait_second) {
-    auto timer = std::make_shared<asio::steady_timer>(
-        control_thread_.get_io_context(), std::chrono::seconds(wait_second));
-    timer->async_wait([this, timer, remote_address = std::move(remote_address),
-                       remote_port](const std::error_code &) {
-      if (auto pos = connection_metas_.find({remote_address, remote_port});
-          pos != connection_metas_.end()) {
-        connect(std::move(remote_address), remote_port, pos->second.meta_);
-      } else {
-        connect(std::move(remote_address), remote_port);
-      }
-    });
-  };
+  auto new_candidates = std::make_shared<candidate_list>();
+  new_candidates->version = version;
+  new_candidates->handles.reserve(target.connection_ids.size());
+  for (auto connection_id : target.connection_ids) {
+    if (auto connection = connected_.find(connection_id); connection) {
+      new_candidates->handles.push_back(connection->get_handle());
+    }
+  }
+  candidates = std::move(new_candidates);
+  std::atomic_store(&target.candidates, candidates);
+  return candidates;
+}
+
+void tcp_client::handle_connection_error(uint64_t connection_id,
+                                         uint32_t attempt,
+                                         const std::error_code &error_code) {
+  control_thread_.get_io_context().post([this, connection_id, attempt,
+                                         error_code] {
+    auto slot = connections_.find(connection_id);
+    if (!slot || slot->attempt != attempt) {
+      // 已经调用 disconnect 断开，或者是上一次链接迟到的通知
+      return;
+    }
 
-  control_thread_.get_io_context().post([this, remote_address, remote_port,
-                                         reconnect] {
-    if (auto pos = connection_metas_.find({remote_address, remote_port});
-        pos == connection_metas_.end()) {
+    _release_connect(connection_id);
+    connected_.remove(connection_id);
+  connected_version_.fetch_add(1, std::memory_order_release);
+    if (slot->connection) {
+      slot->connection->disconnect();
+      slot->connection.reset();
+    }
+    slot->connected = false;
+    auto remote_address = slot->address.host;
+    auto remote_port = slot->address.port;
+    notify_disconnected(error_code, remote_address, remote_port);
+    log_error("connection remote address %s:%u error, reason:%s, disconnect",
+              remote_address.c_str(), remote_port,
+              error_code.message().c_str());
+
+    const auto &meta = slot->meta;
+    if (draining_ || !meta.retry_when_connection_error) {
       log_debug("drop connection %s:%u", remote_address.c_str(), remote_port);
+      _remove_connection(connection_id);
+      notify_dropped(remote_address, remote_port);
+      return;
+    }
+
+    if (!meta.retry_forever && slot->current_retry_cnt >= meta.max_retry_cnt) {
+      log_error("connection remote address %s:%u reaches max retry "
+                "count:%u, drop connection",
+                remote_address.c_str(), remote_port, meta.max_retry_cnt);
+      _remove_connection(connection_id);
       notify_dropped(remote_address, remote_port);
       return;
-    } else {
-      if (!pos->second.meta_.retry_when_connection_error) {
-        log_debug("drop connection %s:%u", remote_address.c_str(), remote_port);
-        notify_dropped(remote_address, remote_port);
-        return;
-      } else {
-        if (!pos->second.meta_.retry_forever) {
-          if (pos->second.current_retry_cnt_ <
-              pos->second.meta_.max_retry_cnt) {
-            ++(pos->second.current_retry_cnt_);
-            log_debug(
-                "try reconnection to %s:%u for %u times after %u seconds, "
-                "max retry count:%u",
-                remote_address.c_str(), remote_port,
-                pos->second.current_retry_cnt_,
-                pos->second.meta_.retry_interval_s,
-                pos->second.meta_.max_retry_cnt);
-            reconnect(pos->second.meta_.retry_interval_s);
-          } else {
-            log_error("connection remote address %s:%u reaches max retry "
-                      "count:%u, drop connection",
-                      remote_address.c_str(), remote_port,
-                      pos->second.meta_.max_retry_cnt);
-            notify_dropped(remote_address, remote_port);
-            return;
-          }
-        } else {
-          log_debug("reconnection to %s:%u after %u seconds",
-                    remote_address.c_str(), remote_port,
-                    pos->second.meta_.retry_interval_s);
-          reconnect(pos->second.meta_.retry_interval_s);
-        }
-      }
     }
+
+    if (slot->current_retry_cnt < std::numeric_limits<uint32_t>::max()) {
+      ++(slot->current_retry_cnt);
+    }
+    auto delay = meta.backoff.enabled()
+                     ? meta.backoff.delay(slot->current_retry_cnt,
+                                          reconnect_random_)
+                     : std::chrono::milliseconds{
+                           std::chrono::seconds{meta.retry_interval_s}};
+    log_debug("try reconnection to %s:%u for %u times after %lld ms",
+              remote_address.c_str(), remote_port, slot->current_retry_cnt,
+              static_cast<long long>(delay.count()));
+    _reconnect(connection_id, delay);
+  });
+}
+
+void tcp_client::_reconnect(uint64_t connection_id,
+                            std::chrono::milliseconds delay) {
+  auto do_reconnect = [this, connection_id] { _connect(connection_id); };
+  if (delay.count() == 0) {
+    control_thread_.get_io_context().post(std::move(do_reconnect));
+    return;
+  }
+  // 所有重连共用一个时间轮，大量链接同时断开时不会为每个链接创建一个定时器，
+  // 同一个 tick 到期的重连在一次推进中批量处理
+  reconnect_wheel_->add(delay, std::move(do_reconnect));
+}
+
+void tcp_client::drain(std::chrono::milliseconds timeout,
+                       std::function<void(const drain_result &)> call_back) {
+  control_thread_.get_io_context().post(
+      [this, timeout, call_back = std::move(call_back)]() mutable {
+        draining_ = true;
+        std::vector<std::shared_ptr<tcp_connection>> connections;
+        connections_.for_each(
+            [&connections](uint64_t, const connection_slot &slot) {
+              if (slot.connected) {
+                connections.push_back(slot.connection);
+              }
+            });
+        drain_context::create(control_thread_.get_io_context(),
+                              std::move(call_back))
+            ->start(connections, timeout);
+      });
+}
+
+drain_result tcp_client::graceful_stop(std::chrono::milliseconds timeout) {
+  std::promise<drain_result> promise;
+  auto future = promise.get_future();
+  drain(timeout, [&promise](const drain_result &result) {
+    promise.set_value(result);
   });
+  auto result = future.get();
+  stop();
+  return result;
 }
 
 tcp_client &tcp_client::set_notify(std::unique_ptr<tcp_client_notify> notify) {
@@ -300,6 +730,18 @@ tcp_client &tcp_client::set_notify(std::unique_ptr<tcp_client_notify> notify) {
   return *this;
 }
 
+tcp_client &
+tcp_client::set_max_concurrent_connects(uint32_t max_concurrent_connects) {
+  max_concurrent_connects_ = max_concurrent_connects;
+  return *this;
+}
+
+tcp_client &
+tcp_client::set_resolve_cache_policy(const resolve_cache_policy &policy) {
+  resolve_cache_.set_policy(policy);
+  return *this;
+}
+
 void tcp_client::notify_connected(const std::string &remote_addr,
                                   uint16_t remote_port) {
   if (notify_)
@@ -319,4 +761,15 @@ void tcp_client::notify_dropped(const std::string &remote_addr,
     notify_->connection_dropped(remote_addr, remote_port);
 }
 
+void tcp_client::notify_write_state(const std::string &remote_addr,
+                                    uint16_t remote_port, bool congested) {
+  if (!notify_)
+    return;
+  if (congested) {
+    notify_->connection_write_congested(remote_addr, remote_port);
+  } else {
+    notify_->connection_write_drained(remote_addr, remote_port);
+  }
+}
+
 } // namespace salt
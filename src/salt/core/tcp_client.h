@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <initializer_list>
 #include <map>
+#include <mutex>
+#include <random>
 #include <set>
 #include <string>
 #include <system_error>
@@ -9,8 +13,19 @@
 #include "asio.hpp"
 
 #include "salt/core/asio_io_context_thread.h"
+#include "salt/core/connection_registry.h"
+#include "salt/core/drain.h"
+#include "salt/core/heartbeat.h"
+#include "salt/core/io_timing_wheel.h"
+#include "salt/core/load_balancer.h"
+#include "salt/core/receive_buffer.h"
+#include "salt/core/reconnect_backoff.h"
+#include "salt/core/resolve_cache.h"
 #include "salt/core/shared_asio_io_context_thread.h"
+#include "salt/core/socket_option.h"
+#include "salt/core/stream_endpoint.h"
 #include "salt/core/tcp_connection.h"
+#include "salt/util/id_table.h"
 
 /**
  * @brief Salt 主命名空间
@@ -55,6 +70,27 @@ public:
    */
   virtual void connection_dropped(const std::string &remote_addr,
                                   uint16_t remote_port) = 0;
+
+  /**
+   * @brief 链接发送队列的字节数超过高水位时，会调用这个接口，
+   *        使用者应该暂停向这个链接发送数据，详细说明请看 send_buffer_policy
+   *
+   * @param remote_addr 服务器地址
+   * @param remote_port 服务器端口
+   */
+  virtual void
+  connection_write_congested(const std::string & /* remote_addr */,
+                             uint16_t /* remote_port */) {}
+
+  /**
+   * @brief 处于拥塞状态的链接，发送队列的字节数降到低水位以下时，会调用这个接口，
+   *        使用者可以继续向这个链接发送数据
+   *
+   * @param remote_addr 服务器地址
+   * @param remote_port 服务器端口
+   */
+  virtual void connection_write_drained(const std::string & /* remote_addr */,
+                                        uint16_t /* remote_port */) {}
 };
 
 /**
@@ -87,6 +123,13 @@ struct connection_meta {
    */
   uint32_t retry_interval_s{5};
 
+  /**
+   * @brief 重连的指数退避配置，设置了 initial_delay 时代替 retry_interval_s。
+   *        链接建立成功以后重新从 initial_delay 开始计算
+   *
+   */
+  reconnect_backoff backoff;
+
   /**
    * @brief
    * 链接级别的拆包器工厂函数，当链接到服务器时，如果设置了这个属性，则使用这个函数来创建拆包器。否则使用
@@ -94,6 +137,90 @@ struct connection_meta {
    *
    */
   std::function<base_packet_assemble *(void)> assemble_creator;
+
+  /**
+   * @brief 链接的接收缓冲区配置
+   *
+   */
+  receive_buffer_policy receive_buffer;
+
+  /**
+   * @brief 一次批量发送的最大字节数，发送队列中的数据会合并到一次 async_write 中发送
+   *
+   */
+  uint32_t send_batch_max_bytes{64 * 1024};
+
+  /**
+   * @brief 链接的发送队列配置，拥塞状态的变化会通过
+   * tcp_client_notify::connection_write_congested 和
+   * tcp_client_notify::connection_write_drained 通知
+   *
+   */
+  send_buffer_policy send_buffer;
+
+  /**
+   * @brief 链接的 socket 选项。SO_SNDBUF、SO_RCVBUF、TCP_NODELAY 和 SO_BUSY_POLL
+   *        在 connect 之前设置，TCP_QUICKACK 在 connect 完成之后设置
+   *
+   */
+  socket_option socket;
+
+  /**
+   * @brief 链接的空闲超时和心跳配置，空闲超时断开时以 error_code::idle_timeout
+   * 通知 tcp_client_notify::connection_disconnected，并按照重试配置重连
+   *
+   */
+  heartbeat_policy heartbeat;
+
+  /**
+   * @brief 连接一个地址的超时时间，超时以后以 asio::error::timed_out
+   *        结束这个地址的连接，继续尝试下一个地址。设置为0则不超时，
+   *        由系统的 SYN 重试决定
+   *
+   */
+  std::chrono::milliseconds connect_timeout{0};
+
+  /**
+   * @brief 域名解析出多个地址时，每隔这个时间开始连接下一个地址，不等待上一个地址
+   *        的连接结果，使用第一个连接成功的地址（Happy Eyeballs，RFC 8305）。
+   *        地址按照 ipv6、ipv4 交替排列。一个地址连接失败时立即开始下一个地址。
+   *        设置为0则依次连接每个地址
+   *
+   */
+  std::chrono::milliseconds connection_attempt_delay{0};
+};
+
+/**
+ * @brief 服务的一个后端地址
+ *
+ */
+struct service_endpoint {
+  std::string address_v4;
+  uint16_t port{0};
+};
+
+/**
+ * @brief 添加服务时的配置
+ *
+ */
+struct service_meta {
+  /**
+   * @brief 每个后端地址建立的链接数，单个 tcp 链接的吞吐量不够时可以增加
+   *
+   */
+  uint32_t connections_per_endpoint{1};
+
+  /**
+   * @brief 负载均衡策略
+   *
+   */
+  load_balance_policy policy{load_balance_policy::round_robin};
+
+  /**
+   * @brief 服务中每个链接的配置
+   *
+   */
+  connection_meta connection;
 };
 
 /**
@@ -133,6 +260,26 @@ public:
    */
   tcp_client &set_notify(std::unique_ptr<tcp_client_notify> notify);
 
+  /**
+   * @brief 设置同时进行中的 connect（包括重连）的最大数量，超过以后的 connect
+   *        排队等待，有 connect 完成（成功或者失败）以后再开始。大量链接同时重连时
+   *        可以避免瞬间压垮服务端。需要在 connect 之前调用
+   *
+   * @param max_concurrent_connects 最大数量，为0时不限制
+   * @return tcp_client& tcp_client 自己
+   */
+  tcp_client &set_max_concurrent_connects(uint32_t max_concurrent_connects);
+
+  /**
+   * @brief 设置域名解析缓存的配置。所有链接共用一个缓存，大量链接同时重连到
+   *        同一个域名时只解析一次；数字形式的地址不经过系统解析接口。
+   *        需要在 connect 之前调用
+   *
+   * @param policy 缓存的配置，默认缓存30秒，解析失败缓存5秒
+   * @return tcp_client& tcp_client 自己
+   */
+  tcp_client &set_resolve_cache_policy(const resolve_cache_policy &policy);
+
   /**
    * @deprecated 废弃，使用 set_transfer_thread_count 代替
    * @brief 初始化客户端，设置后台线程个数
@@ -148,17 +295,40 @@ public:
    * @param address_v4 服务器 ip 地址
    * @param port 服务器端口
    * @param meta 链接的额外信息，用于配置链接断开或者连接失败时的行为
+   * @return uint64_t 链接 id，重连时保持不变，可以用于按照 id 发送数据和断开链接。
+   *         没有设置拆包器工厂时返回0
    */
-  void connect(std::string address_v4, uint16_t port,
-               const connection_meta &meta);
+  uint64_t connect(std::string address_v4, uint16_t port,
+                   const connection_meta &meta);
 
   /**
    * @brief 连接到服务器，链接断开时不自动重连
    *
    * @param address_v4 服务器 ip 地址(或者域名)
    * @param port 服务器端口
+   * @return uint64_t 链接 id，没有设置拆包器工厂时返回0
+   */
+  uint64_t connect(std::string address_v4, uint16_t port);
+
+  /**
+   * @brief 通过 unix domain socket 连接到同一台机器上的服务器，不经过 tcp/ip
+   *        协议栈。链接的地址为 socket 文件路径，端口为0，按照地址发送数据、
+   *        断开链接以及通知时都使用这个地址和端口。
+   *        meta 的 socket 选项中只有 SO_SNDBUF 和 SO_RCVBUF 生效
+   *
+   * @param path 服务器 socket 文件路径
+   * @param meta 链接的额外信息，用于配置链接断开或者连接失败时的行为
+   * @return uint64_t 链接 id，没有设置拆包器工厂时返回0
+   */
+  uint64_t connect_unix(std::string path, const connection_meta &meta);
+
+  /**
+   * @brief 通过 unix domain socket 连接到服务器，链接断开时不自动重连
+   *
+   * @param path 服务器 socket 文件路径
+   * @return uint64_t 链接 id，没有设置拆包器工厂时返回0
    */
-  void connect(std::string address_v4, uint16_t port);
+  uint64_t connect_unix(std::string path);
 
   /**
    * @brief 断开链接
@@ -169,7 +339,15 @@ public:
   void disconnect(std::string address_v4, uint16_t port);
 
   /**
-   * @brief 向所有已经连接的服务器发送数据
+   * @brief 断开链接
+   *
+   * @param connection_id connect 返回的链接 id
+   */
+  void disconnect(uint64_t connection_id);
+
+  /**
+   * @brief 向所有已经连接的服务器发送数据。可以在任意线程中调用，
+   *        数据直接放入链接的发送队列，不经过控制线程
    *
    * @param data 需要发送的数据
    * @param call_back
@@ -179,7 +357,9 @@ public:
                  std::function<void(const std::error_code &)> call_back);
 
   /**
-   * @brief 向一台已经连接的服务器发送数据
+   * @brief 向一台已经连接的服务器发送数据。可以在任意线程中调用，
+   *        数据直接放入链接的发送队列，不经过控制线程。
+   *        链接不存在时在调用线程中回调 not_connected
    *
    * @param address_v4 服务器 ip 地址
    * @param port 服务器端口
@@ -190,6 +370,52 @@ public:
   void send(std::string address_v4, uint16_t port, std::string data,
             std::function<void(const std::error_code &)> call_back);
 
+  /**
+   * @brief 向一台已经连接的服务器发送数据，按照链接 id 查找链接，
+   *        不需要构造地址字符串。可以在任意线程中调用，
+   *        链接不存在时在调用线程中回调 not_connected
+   *
+   * @param connection_id connect 返回的链接 id
+   * @param data 需要发送的数据
+   * @param call_back
+   * 发送数据完成的回调，一次发送有且仅有一次回调调用，可以从error_code参数获取是否发送成功
+   */
+  void send(uint64_t connection_id, std::string data,
+            std::function<void(const std::error_code &)> call_back);
+
+  /**
+   * @brief 添加一个服务，为每个后端地址建立 connections_per_endpoint 个链接。
+   *        已经存在同名的服务时，替换旧的服务并断开旧服务的链接。
+   *        同一个地址有多个链接时，按照地址发送、断开只作用于最后建立的链接
+   *
+   * @param service_name 服务名称
+   * @param endpoints 服务的后端地址
+   * @param meta 服务的配置
+   */
+  void add_service(std::string service_name,
+                   const std::vector<service_endpoint> &endpoints,
+                   const service_meta &meta);
+
+  /**
+   * @brief 移除一个服务，并断开服务的所有链接
+   *
+   * @param service_name 服务名称
+   */
+  void remove_service(const std::string &service_name);
+
+  /**
+   * @brief 按照服务的负载均衡策略，选择一个已经建立的链接发送数据。
+   *        可以在任意线程中调用。服务不存在时回调 service_not_found，
+   *        服务没有已经建立的链接时回调 not_connected，都在调用线程中回调
+   *
+   * @param service_name 服务名称
+   * @param data 需要发送的数据
+   * @param call_back
+   * 发送数据完成的回调，一次发送有且仅有一次回调调用，可以从error_code参数获取是否发送成功
+   */
+  void send(const std::string &service_name, std::string data,
+            std::function<void(const std::error_code &)> call_back);
+
   /**
    * @brief
    * 停止客户端，调用以后客户端会断开所有链接。客户端停止以后，如果需要重新链接，请创建一个新的客户端实例，不要再已经停止的客户端上调用connect
@@ -197,16 +423,104 @@ public:
    */
   void stop();
 
+  /**
+   * @brief 优雅关闭客户端：不再重连，所有已经建立的链接停止处理收到的数据，
+   *        发送完发送队列中的数据以后发送 FIN。超时以后丢弃剩下的数据并关闭链接。
+   *        不会停止后台线程，完成以后需要调用 stop
+   *
+   * @param timeout 超时时间
+   * @param call_back 所有链接处理完成的回调，在后台线程中调用，
+   *        不能在回调中调用 stop
+   */
+  void drain(std::chrono::milliseconds timeout,
+             std::function<void(const drain_result &)> call_back);
+
+  /**
+   * @brief 优雅关闭并停止客户端，等待 drain 完成以后调用 stop。
+   *        会阻塞当前线程，不能在客户端的后台线程中调用
+   *
+   * @param timeout 超时时间
+   * @return drain_result 优雅关闭的结果
+   */
+  drain_result graceful_stop(std::chrono::milliseconds timeout);
+
 private:
-  void _connect(std::string address_v4, uint16_t port);
+  /**
+   * @brief 连接一个地址，连接成功以后 socket 移动到链接中
+   *
+   */
+  struct connect_attempt {
+    explicit connect_attempt(asio::io_context &io_context)
+        : socket(io_context) {}
+
+    stream_socket socket;
+    stream_endpoint endpoint;
+    timing_wheel::timer_id timeout_timer{0};
+    bool timed_out{false};
+  };
+
+  /**
+   * @brief 一次 connect 的状态，只在控制线程中访问
+   *
+   */
+  struct connect_context {
+    std::shared_ptr<tcp_connection> connection;
+    uint64_t connection_id{0};
+    std::string address_v4;
+    uint16_t port{0};
+    socket_option option;
+    std::chrono::milliseconds connect_timeout{0};
+    std::chrono::milliseconds attempt_delay{0};
+    std::vector<stream_endpoint> endpoints;
+    std::size_t next_endpoint{0};
+    std::vector<std::shared_ptr<connect_attempt>> attempts;
+    timing_wheel::timer_id attempt_delay_timer{0};
+    bool finished{false};
+    std::error_code last_error;
+  };
+
+  uint64_t _add_connection(std::string address, uint16_t port,
+                           const connection_meta &meta, bool local);
+
+  void _connect(uint64_t connection_id);
+
+  /**
+   * @brief 按照 RFC 8305 的建议，把解析出来的地址按照 ipv6、ipv4 交替排列，
+   *        同一个地址族内保持解析结果的顺序
+   *
+   */
+  static std::vector<stream_endpoint>
+  _interleave_address_family(const resolve_cache::endpoints &result);
+
+  void _start_connect_attempt(std::shared_ptr<connect_context> context);
+
+  void _handle_connect_attempt(std::shared_ptr<connect_context> context,
+                               std::shared_ptr<connect_attempt> attempt,
+                               std::error_code error_code);
+
+  void _connect_succeeded(std::shared_ptr<connect_context> context,
+                          std::shared_ptr<connect_attempt> attempt);
+
+  void _reconnect(uint64_t connection_id, std::chrono::milliseconds delay);
+
+  void _release_connect(uint64_t connection_id);
+
+  void _admit_waiting_connects();
+
+  void _disconnect(uint64_t connection_id);
+
+  void _remove_connection(uint64_t connection_id);
+
+  uint64_t _find_connection_id(const std::string &address_v4,
+                               uint16_t port) const;
 
-  void _disconnect(std::string address_v4, uint16_t port);
+  void _index_address(const std::string &address_v4, uint16_t port,
+                      uint64_t connection_id);
 
-  void _send(std::string address_v4, uint16_t port, std::string data,
-             std::function<void(const std::error_code &)> call_back);
+  void _unindex_address(const std::string &address_v4, uint16_t port,
+                        uint64_t connection_id);
 
-  void handle_connection_error(const std::string &remote_address,
-                               uint16_t remote_port,
+  void handle_connection_error(uint64_t connection_id, uint32_t attempt,
                                const std::error_code &error_code);
 
   void notify_connected(const std::string &remote_addr, uint16_t remote_port);
@@ -217,6 +531,9 @@ private:
 
   void notify_dropped(const std::string &remote_addr, uint16_t remote_port);
 
+  void notify_write_state(const std::string &remote_addr, uint16_t remote_port,
+                          bool congested);
+
 private:
   struct addr_v4 {
     std::string host;
@@ -230,14 +547,65 @@ private:
     }
   };
 
-  struct connection_meta_impl {
-    connection_meta meta_;
-    uint32_t current_retry_cnt_{0};
+  /**
+   * @brief 一次 connect 对应的链接信息，重连时复用
+   *
+   */
+  struct connection_slot {
+    addr_v4 address;
+    connection_meta meta;
+    uint32_t current_retry_cnt{0};
+
+    /**
+     * @brief 是否是 unix domain socket 链接，为 true 时 address.host 为 socket
+     *        文件路径
+     *
+     */
+    bool local{false};
+
+    /**
+     * @brief 第几次建立链接，用来忽略上一次链接迟到的断开通知
+     *
+     */
+    uint32_t attempt{0};
+    bool connecting{false};
+    bool connected{false};
+    std::shared_ptr<tcp_connection> connection;
   };
 
-  std::map<addr_v4, std::shared_ptr<tcp_connection>> connected_;
-  std::map<addr_v4, std::shared_ptr<tcp_connection>> all_;
-  std::map<addr_v4, connection_meta_impl> connection_metas_;
+  std::atomic<uint64_t> next_connection_id_{1};
+  // 只在控制线程中访问
+  id_table<connection_slot> connections_;
+  // 已经建立的链接，发送数据时在调用线程中查找，不经过控制线程
+  connection_registry connected_;
+  // connected_ 每次添加、删除以后加一，服务的候选链接据此判断是否需要重新生成
+  std::atomic<uint64_t> connected_version_{0};
+  using address_index = std::map<addr_v4, uint64_t>;
+  // 按照地址发送、断开链接时使用，同一个地址对应最近一次 connect 的链接。
+  // 只在控制线程中修改，修改时复制以后整体替换，其它线程原子地读取
+  std::shared_ptr<const address_index> address_index_{
+      std::make_shared<const address_index>()};
+
+  struct candidate_list {
+    uint64_t version{0};
+    std::vector<std::shared_ptr<connection_handle>> handles;
+  };
+
+  struct service {
+    std::vector<uint64_t> connection_ids;
+    std::unique_ptr<load_balancer> balancer;
+    // 已经建立的链接的 handle，链接建立或者断开以后由下一次发送重新生成，
+    // 发送时原子地读取
+    std::shared_ptr<const candidate_list> candidates;
+  };
+
+  std::shared_ptr<const candidate_list> _service_candidates(service &target);
+
+  using service_table = std::map<std::string, std::shared_ptr<service>>;
+  // 只在添加、移除服务时加锁，发送时原子地读取
+  std::mutex service_mutex_;
+  std::shared_ptr<const service_table> services_{
+      std::make_shared<const service_table>()};
   std::function<base_packet_assemble *(void)> assemble_creator_{nullptr};
   std::unique_ptr<tcp_client_notify> notify_{nullptr};
 
@@ -246,8 +614,17 @@ private:
   asio::executor_work_guard<asio::io_context::executor_type>
       transfer_io_context_work_guard_;
   asio_io_context_thread control_thread_;
-  asio::ip::tcp::resolver resolver_;
+  // 只在控制线程中访问
+  resolve_cache resolve_cache_;
   std::vector<std::shared_ptr<shared_asio_io_context_thread>> io_threads_;
+  std::shared_ptr<io_timing_wheel> timing_wheel_;
+  std::shared_ptr<io_timing_wheel> reconnect_wheel_;
+  std::minstd_rand reconnect_random_{std::random_device{}()};
+  uint32_t max_concurrent_connects_{0};
+  // 以下只在控制线程中访问
+  uint32_t connecting_count_{0};
+  std::deque<uint64_t> waiting_connects_;
+  bool draining_{false};
 };
 
 } // namespace salt
\ No newline at end of file
@@ -5,78 +5,198 @@
 
 #include "salt/core/error.h"
 #include "salt/core/log.h"
+#include "salt/core/socket_option.h"
 #include "salt/core/tcp_connection_handle.h"
 #include "salt/util/call_back_wrapper.h"
 
 namespace salt {
 
+static int64_t steady_now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static int64_t steady_now_ms() { return steady_now_us() / 1000; }
+
 std::shared_ptr<tcp_connection> tcp_connection::create(
     asio::io_context &transfer_io_context,
     base_packet_assemble *packet_assemble,
     std::function<void(const std::string &remote_address, uint16_t remote_port,
                        const std::error_code &error_code)>
-        read_notify_callback /* = nullptr */
+        read_notify_callback /* = nullptr */,
+    bool single_thread /* = false */, uint64_t id /* = 0 */
 ) {
-  auto connection = std::shared_ptr<tcp_connection>(new tcp_connection(
-      transfer_io_context, packet_assemble, std::move(read_notify_callback)));
+  auto connection = std::shared_ptr<tcp_connection>(
+      new tcp_connection(transfer_io_context, packet_assemble,
+                         std::move(read_notify_callback), single_thread, id));
   if (connection) {
     connection->init();
+    connection->handle_ = tcp_connection_handle::create(connection);
   }
   return connection;
 }
 
-void tcp_connection::disconnect() {
+void tcp_connection::disconnect() { _disconnect(true); }
+
+void tcp_connection::_disconnect(bool post_call_back) {
   log_debug("socket %s:%u disconnect from %s:%u", local_address_.c_str(),
             local_port_, remote_address_.c_str(), remote_port_);
+  _cancel_heartbeat();
   std::error_code error_code;
   socket_.close(error_code);
-  send_items_.clear();
+  decltype(send_items_) dropped_items;
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    dropped_items.swap(send_items_);
+    send_flag_.clear();
+  }
+  std::size_t dropped_bytes{0};
+  for (const auto &item : dropped_items) {
+    dropped_bytes += item.first.size();
+  }
+  pending_send_bytes_.fetch_sub(dropped_bytes, std::memory_order_relaxed);
   receive_buffer_.clear();
-  receive_buffer_.resize(receive_buffer_max_size_);
-  send_flag_.clear();
+  receive_buffer_.resize(receive_buffer_sizer_.size());
+
+  // 丢弃的数据同样需要调用回调，async_send 等待回调恢复调用方
+  auto aborted = asio::error::make_error_code(asio::error::operation_aborted);
+  for (auto &item : dropped_items) {
+    if (!item.second) {
+      continue;
+    }
+    if (post_call_back) {
+      asio::post(executor_, [call_back = std::move(item.second), aborted] {
+        call_back(aborted);
+      });
+    } else {
+      item.second(aborted);
+    }
+  }
 }
 
-void tcp_connection::_send(
-    std::string data, std::function<void(const std::error_code &)> call_back) {
+void tcp_connection::_send() {
+  std::size_t batch_bytes{0};
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    while (!send_items_.empty() &&
+           (sending_items_.empty() || batch_bytes < send_batch_max_bytes_)) {
+      batch_bytes += send_items_.front().first.size();
+      sending_items_.push_back(std::move(send_items_.front()));
+      send_items_.pop_front();
+    }
+  }
+  if (sending_items_.empty()) {
+    // 发送队列在写操作发起之前被 disconnect 清空
+    return;
+  }
+
+  send_buffers_.clear();
+  for (const auto &item : sending_items_) {
+    send_buffers_.push_back(asio::buffer(item.first));
+  }
+
+  log_debug("send %zu items, %zu bytes in one batch", sending_items_.size(),
+            batch_bytes);
   auto _this{shared_from_this()};
   asio::async_write(
-      this->socket_, asio::buffer(data),
+      this->socket_, send_buffers_,
       asio::bind_executor(
-          strand_, [this, _this, call_back](const std::error_code &err_code,
-                                            std::size_t length) {
-            call(call_back, err_code);
-            if (this->send_items_.empty()) {
-              this->send_flag_.clear();
+          executor_, [this, _this, batch_bytes](
+                         const std::error_code &err_code, std::size_t length) {
+            for (auto &item : this->sending_items_) {
+              call(item.second, err_code);
+            }
+            this->sending_items_.clear();
+            if (!err_code && this->draining_.load(std::memory_order_relaxed)) {
+              this->drain_flushed_bytes_ += batch_bytes;
+            }
+            auto pending = this->pending_send_bytes_.fetch_sub(
+                               batch_bytes, std::memory_order_relaxed) -
+                           batch_bytes;
+            if (this->write_congested_.load(std::memory_order_relaxed) &&
+                pending <= this->send_buffer_policy_.low_watermark) {
+              log_debug("connection %s:%u drained, pending %zu bytes",
+                        remote_address_.c_str(), remote_port_, pending);
+              this->write_congested_.store(false, std::memory_order_relaxed);
+              call(this->write_state_callback_, false);
+            }
+            bool idle{false};
+            {
+              std::lock_guard<std::mutex> lock(this->send_mutex_);
+              idle = this->send_items_.empty();
+              if (idle) {
+                this->send_flag_.clear();
+              }
+            }
+            if (idle) {
+              if (this->drain_callback_) {
+                _finish_drain(false);
+              }
               return;
             } else {
-              auto item = this->send_items_.front();
-              this->send_items_.pop_front();
-              _send(std::move(item.first), std::move(item.second));
+              _send();
             }
           }));
 }
 
 void tcp_connection::send(
     std::string data, std::function<void(const std::error_code &)> call_back) {
+  auto size = data.size();
+  auto pending =
+      pending_send_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+  if (send_buffer_policy_.max_bytes != 0 &&
+      pending > send_buffer_policy_.max_bytes) {
+    pending_send_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    log_error("too many send bytes(%zu), limit:%zu, drop data", pending,
+              send_buffer_policy_.max_bytes);
+    if (call_back) {
+      // 保持回调总是在 executor_ 中调用
+      asio::post(executor_, [call_back = std::move(call_back)] {
+        call_back(make_error_code(error_code::send_queue_full));
+      });
+    }
+    return;
+  }
+
+  bool start_send{false};
+  {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    send_items_.emplace_back(std::move(data), std::move(call_back));
+    start_send = !send_flag_.test_and_set();
+  }
+
   auto _this{shared_from_this()};
-  transfer_io_context_.post(asio::bind_executor(
-      strand_, [this, _this, data = std::move(data), call_back] {
-        if (!send_flag_.test_and_set()) {
-          // 没有未完成的写操作
-          _send(data, std::move(call_back));
-        } else {
-          // 有未完成的写操作
-          if (this->send_items_.size() > this->send_buffer_max_size_) {
-            log_error("too many send items(%u), drop data",
-                      this->send_buffer_max_size_);
-            call(call_back, make_error_code(error_code::send_queue_full));
-          } else {
-            this->send_items_.push_back(
-                std::make_pair(std::move(data), std::move(call_back)));
-          }
-          return;
-        }
-      }));
+  if (send_buffer_policy_.high_watermark != 0 &&
+      !write_congested_.load(std::memory_order_relaxed) &&
+      pending >= send_buffer_policy_.high_watermark) {
+    // 拥塞状态只在 executor_ 中修改，保证状态变化的回调按顺序调用
+    asio::post(executor_, [this, _this] { _update_write_state(); });
+  }
+  if (start_send) {
+    // 没有未完成的写操作
+    asio::post(executor_, [this, _this] { _send(); });
+  }
+}
+
+void tcp_connection::_update_write_state() {
+  auto pending = pending_send_bytes();
+  if (!write_congested_.load(std::memory_order_relaxed) &&
+      pending >= send_buffer_policy_.high_watermark) {
+    log_debug("connection %s:%u congested, pending %zu bytes",
+              remote_address_.c_str(), remote_port_, pending);
+    write_congested_.store(true, std::memory_order_relaxed);
+    call(write_state_callback_, true);
+  }
+}
+
+void tcp_connection::set_write_state_callback(
+    std::function<void(bool congested)> call_back) {
+  auto _this{shared_from_this()};
+  asio::post(executor_,
+             [this, _this, call_back = std::move(call_back)]() mutable {
+               write_state_callback_ = std::move(call_back);
+             });
 }
 
 bool tcp_connection::read() {
@@ -85,46 +205,88 @@ bool tcp_connection::read() {
     return false;
   }
   log_debug("tcp socket %p start to read", this);
+  if (receive_buffer_.size() != receive_buffer_sizer_.size()) {
+    auto shrink = receive_buffer_sizer_.size() < receive_buffer_.size();
+    receive_buffer_.resize(receive_buffer_sizer_.size());
+    if (shrink) {
+      receive_buffer_.shrink_to_fit();
+    }
+  }
   auto _this{shared_from_this()};
   socket_.async_read_some(
       asio::buffer(receive_buffer_),
-      [this, _this](const std::error_code &err_code, std::size_t data_length) {
-        if (err_code && data_length <= 0) {
-          log_error("read data from %s:%u error, reason:%s",
-                    remote_address_.c_str(), remote_port_,
-                    err_code.message().c_str());
-          notify_connection_error(err_code);
-          return;
-        } else if (err_code) {
-          log_error(
-              "read data from %s:%u error, but remain %zu byte data, reason:%s",
-              remote_address_.c_str(), remote_port_, data_length,
-              err_code.message().c_str());
-          notify_connection_error(err_code);
-          return;
-        }
-        log_debug("receive %zu byte data", data_length);
-        std::string data{this->receive_buffer_.begin(),
-                         this->receive_buffer_.begin() + data_length};
-        auto read_result = this->packet_assemble_->data_received(
-            tcp_connection_handle::create(_this), std::move(data));
-        if (read_result == data_read_result::disconnect) {
-          log_error(
-              "read data from %s:%u finish, packet assemble return disconnect",
-              remote_address_.c_str(), remote_port_);
-          this->disconnect();
-          notify_connection_error(
-              make_error_code(error_code::require_disconnecet));
-          return;
-        } else if (read_result == data_read_result::error) {
-          log_error("read data from %s:%u error, but continue read",
-                    remote_address_.c_str(), remote_port_);
-        } else {
-          log_debug("read data from %s:%u success, continue read",
-                    remote_address_.c_str(), remote_port_);
-        }
-        this->read();
-      });
+      asio::bind_executor(
+          executor_, [this, _this](const std::error_code &err_code,
+                                   std::size_t data_length) {
+            if (err_code &&
+                this->idle_timed_out_.load(std::memory_order_relaxed)) {
+              // 空闲超时关闭 socket 导致的读取失败，以空闲超时作为断开原因
+              notify_connection_error(
+                  make_error_code(error_code::idle_timeout));
+              return;
+            } else if (err_code && this->close_requested_.load(
+                                       std::memory_order_relaxed)) {
+              notify_connection_error(
+                  make_error_code(error_code::require_disconnecet));
+              return;
+            } else if (err_code &&
+                       this->draining_.load(std::memory_order_relaxed)) {
+              log_debug("connection %s:%u closed while draining, reason:%s",
+                        remote_address_.c_str(), remote_port_,
+                        err_code.message().c_str());
+              if (this->drain_callback_) {
+                _finish_drain(false);
+              }
+              notify_connection_error(err_code);
+              return;
+            } else if (err_code && data_length <= 0) {
+              log_error("read data from %s:%u error, reason:%s",
+                        remote_address_.c_str(), remote_port_,
+                        err_code.message().c_str());
+              notify_connection_error(err_code);
+              return;
+            } else if (err_code) {
+              log_error("read data from %s:%u error, but remain %zu byte data, "
+                        "reason:%s",
+                        remote_address_.c_str(), remote_port_, data_length,
+                        err_code.message().c_str());
+              notify_connection_error(err_code);
+              return;
+            }
+            if (this->draining_.load(std::memory_order_relaxed)) {
+              // 优雅关闭中，丢弃收到的数据，等待对端关闭链接
+              this->read();
+              return;
+            }
+            log_debug("receive %zu byte data", data_length);
+            if (this->heartbeat_policy_.enabled()) {
+              this->last_read_ms_.store(steady_now_ms(),
+                                        std::memory_order_relaxed);
+            }
+            if (this->quick_ack_) {
+              apply_quick_ack(this->socket_);
+            }
+            auto read_result = this->packet_assemble_->data_received(
+                this->handle_,
+                std::string_view{this->receive_buffer_.data(), data_length});
+            this->receive_buffer_sizer_.record(data_length);
+            if (read_result == data_read_result::disconnect) {
+              log_error("read data from %s:%u finish, packet assemble return "
+                        "disconnect",
+                        remote_address_.c_str(), remote_port_);
+              this->disconnect();
+              notify_connection_error(
+                  make_error_code(error_code::require_disconnecet));
+              return;
+            } else if (read_result == data_read_result::error) {
+              log_error("read data from %s:%u error, but continue read",
+                        remote_address_.c_str(), remote_port_);
+            } else {
+              log_debug("read data from %s:%u success, continue read",
+                        remote_address_.c_str(), remote_port_);
+            }
+            this->read();
+          }));
   return true;
 }
 
@@ -137,4 +299,182 @@ void tcp_connection::handle_fail_connection(const std::error_code &error_code) {
   notify_connection_error(error_code);
 }
 
+void tcp_connection::start_heartbeat() {
+  if (!heartbeat_policy_.enabled() || timing_wheel_.expired()) {
+    return;
+  }
+
+  last_read_ms_.store(steady_now_ms(), std::memory_order_relaxed);
+  if (heartbeat_policy_.idle_timeout.count() > 0) {
+    _add_idle_timer(heartbeat_policy_.idle_timeout);
+  }
+  if (heartbeat_policy_.ping_interval.count() > 0 &&
+      heartbeat_policy_.ping_creator) {
+    _add_ping_timer(heartbeat_policy_.ping_interval);
+  }
+}
+
+void tcp_connection::pong_received() {
+  auto sent_us = ping_sent_us_.exchange(0, std::memory_order_relaxed);
+  if (sent_us > 0) {
+    rtt_us_.store(steady_now_us() - sent_us, std::memory_order_relaxed);
+  }
+}
+
+void tcp_connection::_add_idle_timer(std::chrono::milliseconds delay) {
+  auto timing_wheel = timing_wheel_.lock();
+  if (!timing_wheel) {
+    return;
+  }
+
+  // 收到数据时只更新时间，不重新添加定时器。定时器到期时再根据最后一次收到数据的
+  // 时间判断是否真的超时，没有超时则按照剩余时间重新添加
+  std::weak_ptr<tcp_connection> weak_this{shared_from_this()};
+  idle_timer_id_.store(
+      timing_wheel->add(delay,
+                        [weak_this] {
+                          if (auto _this = weak_this.lock(); _this) {
+                            asio::post(_this->executor_,
+                                       [_this] { _this->_check_idle(); });
+                          }
+                        }),
+      std::memory_order_relaxed);
+}
+
+void tcp_connection::_check_idle() {
+  if (!socket_.is_open()) {
+    return;
+  }
+
+  auto idle = std::chrono::milliseconds{
+      steady_now_ms() - last_read_ms_.load(std::memory_order_relaxed)};
+  if (idle < heartbeat_policy_.idle_timeout) {
+    _add_idle_timer(heartbeat_policy_.idle_timeout - idle);
+    return;
+  }
+
+  log_error("connection %s:%u idle for %lld ms, disconnect",
+            remote_address_.c_str(), remote_port_,
+            static_cast<long long>(idle.count()));
+  // 只关闭 socket，未完成的读取会以 error_code::idle_timeout 通知链接断开
+  idle_timed_out_.store(true, std::memory_order_relaxed);
+  _cancel_heartbeat();
+  std::error_code error_code;
+  socket_.close(error_code);
+}
+
+void tcp_connection::close() {
+  auto _this{shared_from_this()};
+  asio::post(executor_, [this, _this] {
+    if (!socket_.is_open()) {
+      return;
+    }
+    log_debug("connection %s:%u close requested", remote_address_.c_str(),
+              remote_port_);
+    // 与空闲超时一样只关闭 socket，由未完成的读取通知链接断开
+    close_requested_.store(true, std::memory_order_relaxed);
+    _cancel_heartbeat();
+    std::error_code error_code;
+    socket_.close(error_code);
+  });
+}
+
+void tcp_connection::_add_ping_timer(std::chrono::milliseconds delay) {
+  auto timing_wheel = timing_wheel_.lock();
+  if (!timing_wheel) {
+    return;
+  }
+
+  std::weak_ptr<tcp_connection> weak_this{shared_from_this()};
+  ping_timer_id_.store(
+      timing_wheel->add(delay,
+                        [weak_this] {
+                          if (auto _this = weak_this.lock(); _this) {
+                            asio::post(_this->executor_,
+                                       [_this] { _this->_check_ping(); });
+                          }
+                        }),
+      std::memory_order_relaxed);
+}
+
+void tcp_connection::_check_ping() {
+  if (!socket_.is_open()) {
+    return;
+  }
+
+  auto idle = std::chrono::milliseconds{
+      steady_now_ms() - last_read_ms_.load(std::memory_order_relaxed)};
+  if (idle < heartbeat_policy_.ping_interval) {
+    _add_ping_timer(heartbeat_policy_.ping_interval - idle);
+    return;
+  }
+
+  ping_sent_us_.store(steady_now_us(), std::memory_order_relaxed);
+  send(heartbeat_policy_.ping_creator(), nullptr);
+  _add_ping_timer(heartbeat_policy_.ping_interval);
+}
+
+void tcp_connection::_cancel_heartbeat() {
+  auto timing_wheel = timing_wheel_.lock();
+  if (!timing_wheel) {
+    return;
+  }
+
+  timing_wheel->cancel(idle_timer_id_.exchange(0, std::memory_order_relaxed));
+  timing_wheel->cancel(ping_timer_id_.exchange(0, std::memory_order_relaxed));
+}
+
+void tcp_connection::drain(
+    std::function<void(const connection_drain_stat &)> call_back) {
+  auto _this{shared_from_this()};
+  asio::post(executor_,
+             [this, _this, call_back = std::move(call_back)]() mutable {
+               drain_callback_ = std::move(call_back);
+               drain_start_ = std::chrono::steady_clock::now();
+               draining_.store(true, std::memory_order_relaxed);
+               bool idle{false};
+               {
+                 std::lock_guard<std::mutex> lock(send_mutex_);
+                 idle = send_items_.empty() && sending_items_.empty();
+               }
+               if (!socket_.is_open() || idle) {
+                 _finish_drain(false);
+               }
+             });
+}
+
+void tcp_connection::drain_timeout() {
+  auto _this{shared_from_this()};
+  asio::post(executor_, [this, _this] {
+    if (drain_callback_) {
+      _finish_drain(true);
+    }
+  });
+}
+
+void tcp_connection::_finish_drain(bool timeout) {
+  connection_drain_stat stat;
+  stat.remote_address = remote_address_;
+  stat.remote_port = remote_port_;
+  stat.flushed_bytes = drain_flushed_bytes_;
+  stat.dropped_bytes = pending_send_bytes();
+  stat.timeout = timeout;
+  stat.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - drain_start_);
+
+  if (timeout) {
+    log_error("drain connection %s:%u timeout, drop %zu bytes",
+              remote_address_.c_str(), remote_port_, stat.dropped_bytes);
+    disconnect();
+  } else {
+    // 只关闭发送方向，对端读到 EOF 以后关闭链接，避免未读取的数据导致 RST
+    std::error_code error_code;
+    socket_.shutdown(asio::socket_base::shutdown_send, error_code);
+  }
+
+  auto call_back = std::move(drain_callback_);
+  drain_callback_ = nullptr;
+  call(call_back, stat);
+}
+
 } // namespace salt
\ No newline at end of file
@@ -1,39 +1,89 @@
 #pragma once
 
+#include <chrono>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <vector>
 
 #include "asio.hpp"
 
+#include "salt/core/drain.h"
+#include "salt/core/heartbeat.h"
+#include "salt/core/io_timing_wheel.h"
 #include "salt/core/log.h"
+#include "salt/core/receive_buffer.h"
+#include "salt/core/send_buffer.h"
+#include "salt/core/stream_endpoint.h"
 #include "salt/packet_assemble/packet_assemble.h"
 
 namespace salt {
 
 class tcp_connection : public std::enable_shared_from_this<tcp_connection> {
 public:
+  /**
+   * @brief 创建链接
+   *
+   * @param transfer_io_context 链接使用的 io_context
+   * @param packet_assemble 链接的拆包器，链接会接管拆包器的生命周期
+   * @param read_notify_callback 链接异常时的回调
+   * @param single_thread transfer_io_context 是否只在一个线程中运行。
+   *        为 true 时链接的回调直接在 io_context 上执行，不再需要 strand
+   * @param id 链接 id，可以通过 connection_handle::id 获取
+   * @return std::shared_ptr<tcp_connection> 创建好的链接
+   */
   static std::shared_ptr<tcp_connection>
   create(asio::io_context &transfer_io_context,
          base_packet_assemble *packet_assemble,
          std::function<void(const std::string &remote_address,
                             uint16_t remote_port,
                             const std::error_code &error_code)>
-             read_notify_callback = nullptr);
+             read_notify_callback = nullptr,
+         bool single_thread = false, uint64_t id = 0);
 
-  inline asio::ip::tcp::socket &get_socket() { return socket_; }
+  inline uint64_t get_id() const { return id_; }
+
+  /**
+   * @brief 获取链接的 socket，可以是 tcp socket，也可以是 unix domain socket
+   *
+   * @return stream_socket& 链接的 socket
+   */
+  inline stream_socket &get_socket() { return socket_; }
+
+  /**
+   * @brief 获取链接回调使用的 executor，投递到这个 executor 上的任务与链接的回调串行执行
+   *
+   * @return const asio::any_io_executor& 链接的 executor
+   */
+  inline const asio::any_io_executor &get_executor() const { return executor_; }
+
+  /**
+   * @brief 获取链接对应的 connection_handle，链接创建时生成，整个生命周期内不变
+   *
+   * @return const std::shared_ptr<connection_handle>& 链接对应的 handle
+   */
+  inline const std::shared_ptr<connection_handle> &get_handle() const {
+    return handle_;
+  }
 
   bool read();
 
   void send(std::string data,
             std::function<void(const std::error_code &)> call_back);
 
+  /**
+   * @brief 关闭 socket，发送队列中还没有发送的数据以
+   *        asio::error::operation_aborted 在 executor 中调用回调
+   *
+   */
   void disconnect();
 
   ~tcp_connection() {
     log_debug("~tcp_connection:%p", this);
-    disconnect();
+    // 析构时 executor 可能已经不再运行，直接调用回调
+    _disconnect(false);
   }
 
   inline void set_remote_address(std::string remote_address) {
@@ -60,40 +110,187 @@ public:
 
   inline uint16_t get_local_port() const { return local_port_; }
 
+  /**
+   * @brief 设置一次批量发送的最大字节数。发送时会把队列中的数据合并到一次
+   *        async_write 中，直到超过这个限制。至少会发送一个数据
+   *
+   * @param send_batch_max_bytes 一次批量发送的最大字节数
+   */
+  inline void set_send_batch_max_bytes(uint32_t send_batch_max_bytes) {
+    send_batch_max_bytes_ = send_batch_max_bytes;
+  }
+
+  /**
+   * @brief 设置是否在每次读取数据以后重新设置 TCP_QUICKACK，需要在 read 之前调用
+   *
+   * @param quick_ack 是否设置 TCP_QUICKACK
+   */
+  inline void set_quick_ack(bool quick_ack) { quick_ack_ = quick_ack; }
+
+  /**
+   * @brief 设置发送队列的配置，需要在 send 之前调用
+   *
+   * @param policy 发送队列配置
+   */
+  inline void set_send_buffer_policy(const send_buffer_policy &policy) {
+    send_buffer_policy_ = policy;
+  }
+
+  /**
+   * @brief 设置链接拥塞状态变化的回调，详细说明请看
+   * connection_handle::set_write_state_callback
+   *
+   * @param call_back 拥塞状态变化的回调
+   */
+  void set_write_state_callback(std::function<void(bool congested)> call_back);
+
+  inline std::size_t pending_send_bytes() const {
+    return pending_send_bytes_.load(std::memory_order_relaxed);
+  }
+
+  inline bool write_congested() const {
+    return write_congested_.load(std::memory_order_relaxed);
+  }
+
   void handle_fail_connection(const std::error_code &error_code);
 
+  /**
+   * @brief 设置空闲超时和心跳的配置，需要在 start_heartbeat 之前调用
+   *
+   * @param timing_wheel 驱动超时检测的时间轮，链接不会延长时间轮的生命周期
+   * @param policy 空闲超时和心跳配置
+   */
+  inline void set_heartbeat(std::weak_ptr<io_timing_wheel> timing_wheel,
+                            const heartbeat_policy &policy) {
+    timing_wheel_ = std::move(timing_wheel);
+    heartbeat_policy_ = policy;
+  }
+
+  /**
+   * @brief 开始空闲超时检测和心跳，链接建立以后调用
+   *
+   */
+  void start_heartbeat();
+
+  /**
+   * @brief 收到心跳回包，用最近一次发送心跳的时间计算 RTT
+   *
+   */
+  void pong_received();
+
+  /**
+   * @brief 请求断开链接，可以在任意线程中调用。socket 在 executor 中关闭，
+   *        未完成的读取以 error_code::require_disconnecet 通知链接断开
+   *
+   */
+  void close();
+
+  inline std::chrono::microseconds rtt() const {
+    return std::chrono::microseconds{rtt_us_.load(std::memory_order_relaxed)};
+  }
+
+  /**
+   * @brief 开始优雅关闭：停止处理收到的数据，发送完发送队列中的数据以后发送 FIN。
+   *        之后继续读取并丢弃数据，直到对端关闭链接
+   *
+   * @param call_back 发送完成或者超时以后的回调，在链接的 executor 中调用
+   */
+  void drain(std::function<void(const connection_drain_stat &)> call_back);
+
+  /**
+   * @brief 优雅关闭超时，丢弃发送队列中剩下的数据并关闭链接
+   *
+   */
+  void drain_timeout();
+
+  /**
+   * @brief 设置接收缓冲区的配置，需要在 read 之前调用
+   *
+   * @param policy 接收缓冲区配置
+   */
+  inline void set_receive_buffer_policy(const receive_buffer_policy &policy) {
+    receive_buffer_sizer_ = receive_buffer_sizer{policy};
+    receive_buffer_.resize(receive_buffer_sizer_.size());
+  }
+
 private:
   tcp_connection(asio::io_context &transfer_io_context,
                  base_packet_assemble *packet_assemble,
                  std::function<void(const std::string &addr, uint16_t port,
                                     const std::error_code &error_code)>
-                     connection_notify_callback)
-      : transfer_io_context_(transfer_io_context), socket_(transfer_io_context),
-        packet_assemble_(packet_assemble),
-        strand_(asio::make_strand(transfer_io_context)),
+                     connection_notify_callback,
+                 bool single_thread, uint64_t id)
+      : id_(id), transfer_io_context_(transfer_io_context),
+        socket_(transfer_io_context), packet_assemble_(packet_assemble),
+        executor_(
+            single_thread
+                ? asio::any_io_executor(transfer_io_context.get_executor())
+                : asio::any_io_executor(asio::make_strand(transfer_io_context))),
         connection_notify_callback_(std::move(connection_notify_callback)) {
     log_debug("create tcp_conection:%p", this);
   }
 
-  void init() { receive_buffer_.resize(receive_buffer_max_size_); }
+  void init() { receive_buffer_.resize(receive_buffer_sizer_.size()); }
 
-  void _send(std::string data,
-             std::function<void(const std::error_code &)> call_back);
+  void _disconnect(bool post_call_back);
+
+  void _send();
+
+  void _update_write_state();
 
   void notify_connection_error(const std::error_code &error_code);
 
+  void _add_idle_timer(std::chrono::milliseconds delay);
+
+  void _check_idle();
+
+  void _add_ping_timer(std::chrono::milliseconds delay);
+
+  void _check_ping();
+
+  void _cancel_heartbeat();
+
+  void _finish_drain(bool timeout);
+
 private:
+  const uint64_t id_;
   asio::io_context &transfer_io_context_;
-  asio::ip::tcp::socket socket_;
-  uint32_t send_buffer_max_size_{256};
+  stream_socket socket_;
+  send_buffer_policy send_buffer_policy_;
+  std::atomic<std::size_t> pending_send_bytes_{0};
+  std::atomic<bool> write_congested_{false};
+  std::function<void(bool congested)> write_state_callback_;
+  // 保护 send_items_ 和 send_flag_，调用 send 的线程直接把数据放入发送队列，
+  // 只有在没有未完成的写操作时才需要切换到 executor_ 发起写操作
+  std::mutex send_mutex_;
   std::deque<std::pair<std::string /* data */,
                        std::function<void(const std::error_code &)>>>
       send_items_;
-  uint32_t receive_buffer_max_size_{1024};
+  std::vector<std::pair<std::string /* data */,
+                        std::function<void(const std::error_code &)>>>
+      sending_items_;
+  std::vector<asio::const_buffer> send_buffers_;
+  uint32_t send_batch_max_bytes_{64 * 1024};
+  receive_buffer_sizer receive_buffer_sizer_;
+  bool quick_ack_{false};
   std::string receive_buffer_;
   std::unique_ptr<base_packet_assemble> packet_assemble_{nullptr};
-  asio::strand<asio::io_context::executor_type> strand_;
+  std::shared_ptr<connection_handle> handle_{nullptr};
+  asio::any_io_executor executor_;
   std::atomic_flag send_flag_{false};
+  std::weak_ptr<io_timing_wheel> timing_wheel_;
+  heartbeat_policy heartbeat_policy_;
+  std::atomic<int64_t> last_read_ms_{0};
+  std::atomic<int64_t> ping_sent_us_{0};
+  std::atomic<int64_t> rtt_us_{0};
+  std::atomic<timing_wheel::timer_id> idle_timer_id_{0};
+  std::atomic<timing_wheel::timer_id> ping_timer_id_{0};
+  std::atomic<bool> idle_timed_out_{false};
+  std::atomic<bool> close_requested_{false};
+  std::atomic<bool> draining_{false};
+  std::function<void(const connection_drain_stat &)> drain_callback_;
+  std::chrono::steady_clock::time_point drain_start_;
+  std::size_t drain_flushed_bytes_{0};
   std::string remote_address_;
   uint16_t remote_port_{0};
   std::string local_address_;
@@ -6,22 +6,60 @@ namespace salt {
 
 void tcp_connection_handle::send(
     std::string data, std::function<void(const std::error_code &)> call_back) {
-  if (!connection_) {
+  auto connection = connection_.lock();
+  if (!connection) {
     call(call_back, make_error_code(error_code::null_connection));
     return;
   }
 
-  connection_->send(std::move(data), std::move(call_back));
+  connection->send(std::move(data), std::move(call_back));
 }
 
+std::size_t tcp_connection_handle::pending_send_bytes() const {
+  auto connection = connection_.lock();
+  return connection ? connection->pending_send_bytes() : 0;
+}
+
+bool tcp_connection_handle::write_congested() const {
+  auto connection = connection_.lock();
+  return connection ? connection->write_congested() : false;
+}
+
+void tcp_connection_handle::set_write_state_callback(
+    std::function<void(bool congested)> call_back) {
+  if (auto connection = connection_.lock(); connection) {
+    connection->set_write_state_callback(std::move(call_back));
+  }
+}
+
+void tcp_connection_handle::pong_received() {
+  if (auto connection = connection_.lock(); connection) {
+    connection->pong_received();
+  }
+}
+
+void tcp_connection_handle::close() {
+  if (auto connection = connection_.lock(); connection) {
+    connection->close();
+  }
+}
+
+std::chrono::microseconds tcp_connection_handle::rtt() const {
+  auto connection = connection_.lock();
+  return connection ? connection->rtt() : std::chrono::microseconds{0};
+}
+
+uint64_t tcp_connection_handle::id() const { return id_; }
+
 tcp_connection_handle::tcp_connection_handle(
-    std::shared_ptr<tcp_connection> connection)
-    : connection_(std::move(connection)) {}
+    const std::shared_ptr<tcp_connection> &connection)
+    : connection_(connection), id_(connection->get_id()) {}
 
 std::shared_ptr<connection_handle>
-tcp_connection_handle::create(std::shared_ptr<tcp_connection> connection) {
+tcp_connection_handle::create(
+    const std::shared_ptr<tcp_connection> &connection) {
   return std::shared_ptr<connection_handle>{
-      new tcp_connection_handle(std::move(connection))};
+      new tcp_connection_handle(connection)};
 }
 
 } // namespace salt
\ No newline at end of file
@@ -5,19 +5,34 @@
 
 namespace salt {
 
+/**
+ * @brief tcp_connection 对应的 connection_handle。
+ *        每个 tcp_connection 只创建一个，handle 不会延长链接的生命周期，
+ *        链接释放以后再通过 handle 发送数据会返回 error_code::null_connection
+ *
+ */
 class tcp_connection_handle : public connection_handle {
 public:
   static std::shared_ptr<connection_handle>
-  create(std::shared_ptr<tcp_connection> connection);
+  create(const std::shared_ptr<tcp_connection> &connection);
   void send(std::string data,
             std::function<void(const std::error_code &)> call_back) override;
+  std::size_t pending_send_bytes() const override;
+  bool write_congested() const override;
+  void set_write_state_callback(
+      std::function<void(bool congested)> call_back) override;
+  void pong_received() override;
+  void close() override;
+  std::chrono::microseconds rtt() const override;
+  uint64_t id() const override;
   ~tcp_connection_handle() override = default;
 
 private:
-  tcp_connection_handle(std::shared_ptr<tcp_connection> connection);
+  tcp_connection_handle(const std::shared_ptr<tcp_connection> &connection);
 
 private:
-  std::shared_ptr<tcp_connection> connection_{nullptr};
+  std::weak_ptr<tcp_connection> connection_;
+  uint64_t id_{0};
 };
 
 } // namespace salt
\ No newline at end of file
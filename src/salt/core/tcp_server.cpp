@@ -1,13 +1,68 @@
 #include "salt/core/tcp_server.h"
 
+#include <future>
 #include <system_error>
 
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "salt/core/drain_context.h"
 #include "salt/core/error.h"
+#include "salt/core/io_backend.h"
 #include "salt/core/log.h"
 #include "salt/core/tcp_connection.h"
+#include "salt/util/call_back_wrapper.h"
 
 namespace salt {
 
+/**
+ * @brief 删除 unix domain socket 文件，只删除 socket 类型的文件
+ *
+ */
+static void remove_socket_file(const std::string &path) {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+  struct stat file_stat;
+  if (::stat(path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) {
+    ::unlink(path.c_str());
+  }
+#endif
+}
+
+/**
+ * @brief 删除上一次运行没有清理的 unix domain socket 文件，否则 bind 会失败。
+ *        先尝试连接，只有连接被拒绝时才认为没有进程在监听，
+ *        避免删除正在运行的服务器的 socket 文件
+ *
+ * @return std::error_code 有进程正在监听时返回 address_in_use
+ */
+static std::error_code remove_stale_socket_file(asio::io_context &io_context,
+                                                const stream_endpoint &endpoint,
+                                                const std::string &path) {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+  struct stat file_stat;
+  if (::stat(path.c_str(), &file_stat) != 0 || !S_ISSOCK(file_stat.st_mode)) {
+    return std::error_code{};
+  }
+
+  std::error_code err_code;
+  stream_socket probe(io_context);
+  probe.connect(endpoint, err_code);
+  if (err_code == asio::error::connection_refused) {
+    log_info("remove stale socket file %s", path.c_str());
+    ::unlink(path.c_str());
+    return std::error_code{};
+  }
+
+  log_error("socket file %s is in use, probe result:%s", path.c_str(),
+            err_code.message().c_str());
+  return asio::error::make_error_code(asio::error::address_in_use);
+#else
+  return std::error_code{};
+#endif
+}
+
 tcp_server::tcp_server()
     : transfer_io_context_work_guard_(transfer_io_context_.get_executor()) {}
 
@@ -15,7 +70,32 @@ tcp_server::~tcp_server() { stop(); }
 
 void tcp_server::stop() {
   accept_thread_.stop();
+  for (auto &accept_thread : extra_accept_threads_) {
+    accept_thread->stop();
+  }
+  close_acceptors();
+  for (auto &timing_wheel : timing_wheels_) {
+    timing_wheel->stop();
+  }
   transfer_io_context_.stop();
+  for (auto &io_thread : per_thread_io_threads_) {
+    io_thread->stop();
+  }
+}
+
+void tcp_server::close_acceptors() {
+  std::vector<std::shared_ptr<stream_acceptor>> acceptors;
+  {
+    std::lock_guard<std::mutex> lock(acceptors_mutex_);
+    acceptors.swap(acceptors_);
+  }
+  for (auto &acceptor : acceptors) {
+    std::error_code err_code;
+    acceptor->close(err_code);
+  }
+  if (!acceptors.empty() && !listen_unix_path_.empty()) {
+    remove_socket_file(listen_unix_path_);
+  }
 }
 
 bool tcp_server::init(uint16_t listen_port, uint32_t io_thread_cnt /* = 1 */) {
@@ -34,13 +114,9 @@ bool tcp_server::init(const std::string &listen_ip_v4, uint16_t listen_port,
       return false;
     }
   }
-  listen_port_ = listen_port;
   log_debug("listen ip address:%s:%u", listen_ip_.to_string().c_str(),
-            listen_port_);
-  for (uint32_t i = 0; i < io_thread_cnt; ++i) {
-    io_threads_.emplace_back(
-        new shared_asio_io_context_thread(transfer_io_context_));
-  }
+            listen_port);
+  set_listen_port(listen_port).set_transfer_thread_count(io_thread_cnt);
   return true;
 }
 
@@ -49,6 +125,11 @@ tcp_server &tcp_server::set_listen_ip_v4(const std::string &listen_ip_v4) {
   return *this;
 }
 
+tcp_server &tcp_server::set_listen_unix_path(const std::string &path) {
+  listen_unix_path_ = path;
+  return *this;
+}
+
 tcp_server &tcp_server::set_listen_port(uint16_t listen_port) {
   listen_port_ = listen_port;
   return *this;
@@ -61,83 +142,398 @@ tcp_server::set_transfer_thread_count(uint32_t transfer_thread_count) {
     transfer_thread_count = 1;
   }
 
-  if (io_threads_.size() != 0) {
+  if (transfer_thread_count_ != 0 || io_threads_.size() != 0) {
     log_info("you can set transfer thread count only once, ignore this core");
     return *this;
   }
 
-  for (auto i = 0u; i < transfer_thread_count; ++i) {
-    io_threads_.emplace_back(
-        new shared_asio_io_context_thread(transfer_io_context_));
-  }
+  transfer_thread_count_ = transfer_thread_count;
+  return *this;
+}
 
+tcp_server &tcp_server::set_transfer_io_mode(transfer_io_mode mode) {
+  transfer_io_mode_ = mode;
   return *this;
 }
 
-std::error_code tcp_server::accept() {
-  if (!acceptor_) {
+void tcp_server::create_transfer_threads() {
+  if (!io_threads_.empty() || !per_thread_io_threads_.empty()) {
+    return;
+  }
+
+  if (transfer_thread_count_ == 0) {
+    transfer_thread_count_ = 1;
+  }
+
+  for (auto i = 0u; i < transfer_thread_count_; ++i) {
+    if (transfer_io_mode_ == transfer_io_mode::per_thread) {
+      per_thread_io_threads_.emplace_back(
+          new asio_io_context_thread(ASIO_CONCURRENCY_HINT_1));
+    } else {
+      io_threads_.emplace_back(
+          new shared_asio_io_context_thread(transfer_io_context_));
+    }
+  }
+}
+
+void tcp_server::create_timing_wheels() {
+  if (!heartbeat_policy_.enabled() || !timing_wheels_.empty()) {
+    return;
+  }
+
+  if (per_thread_io_threads_.empty()) {
+    // 共享 io_context 时，每个传输线程一个时间轮，分散定时器的锁竞争
+    for (auto i = 0u; i < io_threads_.size(); ++i) {
+      timing_wheels_.push_back(io_timing_wheel::create(transfer_io_context_));
+    }
+  } else {
+    for (auto &io_thread : per_thread_io_threads_) {
+      timing_wheels_.push_back(
+          io_timing_wheel::create(io_thread->get_io_context()));
+    }
+  }
+  for (auto &timing_wheel : timing_wheels_) {
+    timing_wheel->start();
+  }
+}
+
+std::shared_ptr<tcp_connection>
+tcp_server::create_connection(uint64_t connection_id) {
+  auto index = next_io_thread_++;
+  auto notify_callback = [this, connection_id](const std::string &, uint16_t,
+                                               const std::error_code &) {
+    remove_connection(connection_id);
+  };
+  std::shared_ptr<tcp_connection> connection;
+  if (per_thread_io_threads_.empty()) {
+    connection = tcp_connection::create(transfer_io_context_,
+                                        assemble_creator_(),
+                                        std::move(notify_callback), false,
+                                        connection_id);
+  } else {
+    auto &io_thread =
+        per_thread_io_threads_[index % per_thread_io_threads_.size()];
+    connection =
+        tcp_connection::create(io_thread->get_io_context(), assemble_creator_(),
+                               std::move(notify_callback), true, connection_id);
+  }
+
+  if (connection && !timing_wheels_.empty()) {
+    connection->set_heartbeat(timing_wheels_[index % timing_wheels_.size()],
+                              heartbeat_policy_);
+  }
+  return connection;
+}
+
+void tcp_server::remove_connection(uint64_t connection_id) {
+  connections_.remove(connection_id);
+}
+
+void tcp_server::send(uint64_t connection_id, std::string data,
+                      std::function<void(const std::error_code &)> call_back) {
+  auto connection = connections_.find(connection_id);
+  if (!connection) {
+    call(call_back, make_error_code(error_code::null_connection));
+    return;
+  }
+  connection->send(std::move(data), std::move(call_back));
+}
+
+void tcp_server::broadcast(
+    std::string data, std::function<void(const std::error_code &)> call_back) {
+  connections_.for_each(
+      [&data, &call_back](const std::shared_ptr<tcp_connection> &connection) {
+        connection->send(data, call_back);
+      });
+}
+
+void tcp_server::for_each(
+    const std::function<void(const std::shared_ptr<connection_handle> &)>
+        &call_back) const {
+  connections_.for_each(
+      [&call_back](const std::shared_ptr<tcp_connection> &connection) {
+        call_back(connection->get_handle());
+      });
+}
+
+void tcp_server::drain(std::chrono::milliseconds timeout,
+                       std::function<void(const drain_result &)> call_back) {
+  std::vector<std::shared_ptr<stream_acceptor>> acceptors;
+  {
+    std::lock_guard<std::mutex> lock(acceptors_mutex_);
+    acceptors = acceptors_;
+  }
+  if (acceptors.empty()) {
+    drain_connections(timeout, std::move(call_back));
+    return;
+  }
+
+  // acceptor 只能在自己的线程中关闭，全部关闭以后不会再有新链接，
+  // 这时再收集需要关闭的链接
+  auto remaining = std::make_shared<std::atomic<std::size_t>>(acceptors.size());
+  auto shared_call_back =
+      std::make_shared<std::function<void(const drain_result &)>>(
+          std::move(call_back));
+  for (auto &acceptor : acceptors) {
+    asio::post(acceptor->get_executor(), [this, acceptor, remaining,
+                                          shared_call_back, timeout] {
+      std::error_code err_code;
+      acceptor->close(err_code);
+      if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        drain_connections(timeout, std::move(*shared_call_back));
+      }
+    });
+  }
+}
+
+void tcp_server::drain_connections(
+    std::chrono::milliseconds timeout,
+    std::function<void(const drain_result &)> call_back) {
+  {
+    std::lock_guard<std::mutex> lock(accept_mutex_);
+    if (accepting_count_ != 0) {
+      // 还有链接在传输线程中初始化，最后一个初始化完成以后再收集
+      pending_drains_.emplace_back(
+          [this, timeout, call_back = std::move(call_back)] {
+            drain_connections(timeout, call_back);
+          });
+      return;
+    }
+  }
+
+  std::vector<std::shared_ptr<tcp_connection>> connections;
+  connections.reserve(connections_.size());
+  connections_.for_each(
+      [&connections](const std::shared_ptr<tcp_connection> &connection) {
+        connections.push_back(connection);
+      });
+
+  drain_context::create(accept_thread_.get_io_context(), std::move(call_back))
+      ->start(connections, timeout);
+}
+
+drain_result tcp_server::graceful_stop(std::chrono::milliseconds timeout) {
+  std::promise<drain_result> promise;
+  auto future = promise.get_future();
+  drain(timeout, [&promise](const drain_result &result) {
+    promise.set_value(result);
+  });
+  auto result = future.get();
+  stop();
+  return result;
+}
+
+std::error_code
+tcp_server::accept(const std::shared_ptr<stream_acceptor> &acceptor) {
+  if (!acceptor) {
     log_error("acceptor is nullptr");
     return make_error_code(error_code::acceptor_is_nullptr);
   }
-  auto connection =
-      tcp_connection::create(transfer_io_context_, assemble_creator_());
+  auto connection_id = next_connection_id_++;
+  auto connection = create_connection(connection_id);
   if (!connection) {
     log_error("create connection error");
     return make_error_code(error_code::internel_error);
   }
-  acceptor_->async_accept(
+  connection->set_receive_buffer_policy(receive_buffer_policy_);
+  connection->set_send_batch_max_bytes(send_batch_max_bytes_);
+  connection->set_send_buffer_policy(send_buffer_policy_);
+  acceptor->async_accept(
       connection->get_socket(),
-      [this, connection](const std::error_code &err_code) {
-        if (!err_code) {
-          {
-            std::error_code error_code;
-            const auto &local_endpoint =
-                connection->get_socket().local_endpoint(error_code);
-            if (!error_code) {
-              connection->set_local_address(
-                  local_endpoint.address().to_string());
-              connection->set_local_port(local_endpoint.port());
-            }
-            const auto &remote_endpoint =
-                connection->get_socket().remote_endpoint(error_code);
-            if (!error_code) {
-              connection->set_remote_address(
-                  remote_endpoint.address().to_string());
-              connection->set_remote_port(remote_endpoint.port());
-            }
-          }
-          log_debug("accept new connection from %s:%u",
-                    connection->get_remote_address().c_str(),
-                    connection->get_remote_port());
-          connection->read();
-        } else {
+      [this, acceptor, connection,
+       connection_id](const std::error_code &err_code) {
+        if (err_code == asio::error::operation_aborted) {
+          log_info("acceptor closed, stop accept");
+          return;
+        }
+
+        // 先发起下一次 accept，链接的初始化放到传输线程中执行，不占用 accept 线程
+        this->accept(acceptor);
+        if (err_code) {
           log_error("accept error, reason:%s", err_code.message().c_str());
+          return;
         }
 
-        this->accept();
+        {
+          std::lock_guard<std::mutex> lock(accept_mutex_);
+          ++accepting_count_;
+        }
+        asio::post(connection->get_executor(),
+                   [this, connection, connection_id] {
+                     handle_accepted(connection, connection_id);
+                   });
       });
   return make_error_code(error_code::success);
 }
 
+void tcp_server::handle_accepted(
+    const std::shared_ptr<tcp_connection> &connection, uint64_t connection_id) {
+  {
+    std::error_code error_code;
+    const auto &local_endpoint =
+        connection->get_socket().local_endpoint(error_code);
+    if (!error_code) {
+      connection->set_local_address(endpoint_address(local_endpoint));
+      connection->set_local_port(endpoint_port(local_endpoint));
+    }
+    // unix domain socket 的客户端通常没有绑定路径，远端地址为空字符串
+    const auto &remote_endpoint =
+        connection->get_socket().remote_endpoint(error_code);
+    if (!error_code) {
+      connection->set_remote_address(endpoint_address(remote_endpoint));
+      connection->set_remote_port(endpoint_port(remote_endpoint));
+    }
+  }
+  log_debug("accept new connection from %s:%u",
+            connection->get_remote_address().c_str(),
+            connection->get_remote_port());
+  auto option = listen_unix_path_.empty()
+                    ? socket_option_
+                    : local_socket_option(socket_option_);
+  apply_connected_option(connection->get_socket(), option);
+  connection->set_quick_ack(option.quick_ack.value_or(false));
+  // 开始读取以后链接才可能断开，在这之前加入，remove_connection 不会早于加入
+  connections_.add(connection_id, connection);
+  connection->start_heartbeat();
+  connection->read();
+
+  std::vector<std::function<void()>> pending_drains;
+  {
+    std::lock_guard<std::mutex> lock(accept_mutex_);
+    if (--accepting_count_ == 0) {
+      pending_drains.swap(pending_drains_);
+    }
+  }
+  for (auto &pending_drain : pending_drains) {
+    pending_drain();
+  }
+}
+
+std::error_code tcp_server::listen(asio::io_context &io_context,
+                                   bool reuse_port,
+                                   const socket_option &option) {
+  std::error_code err_code;
+  auto acceptor = std::make_shared<stream_acceptor>(io_context);
+  stream_endpoint endpoint;
+  if (listen_unix_path_.empty()) {
+    endpoint = asio::ip::tcp::endpoint(listen_ip_, listen_port_);
+  } else {
+    endpoint = make_local_endpoint(listen_unix_path_, err_code);
+    if (!err_code) {
+      err_code =
+          remove_stale_socket_file(io_context, endpoint, listen_unix_path_);
+    }
+  }
+  if (!err_code) {
+    acceptor->open(endpoint.protocol(), err_code);
+  }
+  if (!err_code && listen_unix_path_.empty()) {
+    acceptor->set_option(stream_acceptor::reuse_address(true), err_code);
+  }
+#ifdef SO_REUSEPORT
+  if (!err_code && reuse_port) {
+    acceptor->set_option(
+        asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true),
+        err_code);
+  }
+#endif
+  if (!err_code) {
+    err_code = apply_listen_option(*acceptor, option);
+  }
+  if (!err_code) {
+    acceptor->bind(endpoint, err_code);
+  }
+  if (!err_code) {
+    acceptor->listen(option.listen_backlog, err_code);
+  }
+  if (err_code) {
+    log_error("listen on %s:%u error, reason:%s",
+              get_listen_address().c_str(), listen_port_,
+              err_code.message().c_str());
+    return err_code;
+  }
+
+  if (listen_unix_path_.empty() && listen_port_ == 0) {
+    // 监听随机端口时，其它 acceptor 需要监听同一个端口
+    listen_port_ = endpoint_port(acceptor->local_endpoint(err_code));
+  }
+
+  std::lock_guard<std::mutex> lock(acceptors_mutex_);
+  acceptors_.push_back(acceptor);
+  return make_error_code(error_code::success);
+}
+
 std::error_code tcp_server::start() {
   if (!assemble_creator_) {
     log_error("assemble creator not set");
     return make_error_code(error_code::assemble_creator_not_set);
   }
 
-  if (io_threads_.empty()) {
-    set_transfer_thread_count(1);
+  {
+    std::lock_guard<std::mutex> lock(acceptors_mutex_);
+    if (!acceptors_.empty()) {
+      log_error("tcp_server already started, listen:%s:%u",
+                get_listen_address().c_str(), listen_port_);
+      return make_error_code(error_code::already_started);
+    }
   }
 
-  if (!acceptor_) {
-    acceptor_ = std::make_shared<asio::ip::tcp::acceptor>(
-        accept_thread_.get_io_context(),
-        asio::ip::tcp::endpoint(listen_ip_, listen_port_));
-    return accept();
-  } else {
-    log_error("tcp_server already started, listen:%s:%u",
-              listen_ip_.to_string().c_str(), listen_port_);
-    return make_error_code(error_code::already_started);
+  log_info("tcp_server start with %s io backend",
+           io_backend_name(current_io_backend()));
+  create_transfer_threads();
+  create_timing_wheels();
+
+  auto acceptor_count = acceptor_count_;
+  auto option = socket_option_;
+  if (!listen_unix_path_.empty()) {
+    // unix domain socket 不支持 SO_REUSEPORT 分配链接，也没有 tcp 选项
+    acceptor_count = 1;
+    option = local_socket_option(socket_option_);
+  }
+#ifndef SO_REUSEPORT
+  if (acceptor_count > 1) {
+    log_info("SO_REUSEPORT is not supported, use 1 acceptor");
+    acceptor_count = 1;
+  }
+#endif
+
+  // 部分 acceptor 失败时关闭已经监听的 acceptor，监听随机端口时恢复端口，
+  // 保证可以重新调用 start
+  auto listen_port = listen_port_;
+  auto fail = [this, listen_port](const std::error_code &err_code) {
+    close_acceptors();
+    listen_port_ = listen_port;
+    return err_code;
+  };
+  for (auto i = 0u; i < acceptor_count; ++i) {
+    auto accept_thread = &accept_thread_;
+    if (i != 0) {
+      // 重新调用 start 时复用之前创建的线程
+      if (extra_accept_threads_.size() < i) {
+        extra_accept_threads_.emplace_back(
+            new asio_io_context_thread(ASIO_CONCURRENCY_HINT_1));
+      }
+      accept_thread = extra_accept_threads_[i - 1].get();
+    }
+    auto err_code =
+        listen(accept_thread->get_io_context(), acceptor_count > 1, option);
+    if (err_code) {
+      return fail(err_code);
+    }
+  }
+
+  std::vector<std::shared_ptr<stream_acceptor>> acceptors;
+  {
+    std::lock_guard<std::mutex> lock(acceptors_mutex_);
+    acceptors = acceptors_;
+  }
+  for (const auto &acceptor : acceptors) {
+    for (auto i = 0u; i < pending_accept_count_; ++i) {
+      auto err_code = accept(acceptor);
+      if (err_code) {
+        return fail(err_code);
+      }
+    }
   }
   return make_error_code(error_code::success);
 }
@@ -148,4 +544,50 @@ tcp_server &tcp_server::set_assemble_creator(
   return *this;
 }
 
+tcp_server &
+tcp_server::set_receive_buffer_policy(const receive_buffer_policy &policy) {
+  receive_buffer_policy_ = policy;
+  return *this;
+}
+
+tcp_server &tcp_server::set_send_batch_max_bytes(uint32_t send_batch_max_bytes) {
+  send_batch_max_bytes_ = send_batch_max_bytes;
+  return *this;
+}
+
+tcp_server &
+tcp_server::set_send_buffer_policy(const send_buffer_policy &policy) {
+  send_buffer_policy_ = policy;
+  return *this;
+}
+
+tcp_server &tcp_server::set_acceptor_count(uint32_t acceptor_count) {
+  if (acceptor_count == 0) {
+    log_info("acceptor_count is 0, change to 1");
+    acceptor_count = 1;
+  }
+  acceptor_count_ = acceptor_count;
+  return *this;
+}
+
+tcp_server &
+tcp_server::set_pending_accept_count(uint32_t pending_accept_count) {
+  if (pending_accept_count == 0) {
+    log_info("pending_accept_count is 0, change to 1");
+    pending_accept_count = 1;
+  }
+  pending_accept_count_ = pending_accept_count;
+  return *this;
+}
+
+tcp_server &tcp_server::set_socket_option(const socket_option &option) {
+  socket_option_ = option;
+  return *this;
+}
+
+tcp_server &tcp_server::set_heartbeat_policy(const heartbeat_policy &policy) {
+  heartbeat_policy_ = policy;
+  return *this;
+}
+
 } // namespace salt
\ No newline at end of file
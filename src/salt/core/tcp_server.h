@@ -1,17 +1,47 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "asio.hpp"
 
 #include "salt/core/asio_io_context_thread.h"
+#include "salt/core/connection_registry.h"
+#include "salt/core/drain.h"
+#include "salt/core/heartbeat.h"
+#include "salt/core/io_timing_wheel.h"
+#include "salt/core/receive_buffer.h"
 #include "salt/core/shared_asio_io_context_thread.h"
+#include "salt/core/socket_option.h"
+#include "salt/core/stream_endpoint.h"
 #include "salt/core/tcp_connection.h"
 
 namespace salt {
 
+/**
+ * @brief 后台传输线程的运行方式
+ *
+ */
+enum class transfer_io_mode {
+  /**
+   * @brief 所有传输线程共享同一个 io_context，链接的回调可能在任意传输线程中执行，
+   *        每个链接使用一个 strand 保证回调串行
+   *
+   */
+  shared = 1,
+
+  /**
+   * @brief 每个传输线程拥有自己的 io_context，新链接按照轮询的方式分配到一个传输线程上，
+   *        并且在整个生命周期内都只在这个线程中执行，不再需要 strand
+   *
+   */
+  per_thread,
+};
+
 /**
  * @brief tcp 服务器，你可以通过此类来启动一个 tcp 服务器。
  *
@@ -66,6 +96,18 @@ public:
    */
   tcp_server &set_listen_ip_v4(const std::string &listen_ip_v4);
 
+  /**
+   * @brief 监听 unix domain socket 而不是 tcp 端口，用于同一台机器上的进程间通信，
+   *        不经过 tcp/ip 协议栈。设置以后忽略监听地址、端口和 acceptor_count，
+   *        socket 选项中只有 SO_SNDBUF、SO_RCVBUF 和 backlog 生效。
+   *        启动时删除路径上没有进程监听的 socket 文件，有进程监听时 start 返回
+   *        address_in_use；停止时删除创建的 socket 文件。需要在 start 之前调用
+   *
+   * @param path socket 文件路径，为空时监听 tcp 端口
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_listen_unix_path(const std::string &path);
+
   /**
    * @brief 设置需要监听的端口
    *
@@ -82,6 +124,36 @@ public:
    */
   tcp_server &set_transfer_thread_count(uint32_t transfer_thread_count);
 
+  /**
+   * @brief 设置后台传输线程的运行方式，默认为 transfer_io_mode::shared。
+   *        需要在 start 之前调用
+   *
+   * @param mode 传输线程的运行方式
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_transfer_io_mode(transfer_io_mode mode);
+
+  /**
+   * @brief 设置监听 socket 的个数，默认为1。
+   *        大于1时，每个监听 socket 都会设置 SO_REUSEPORT 并且绑定同一个地址，
+   *        由内核将新链接分配到各个监听 socket 上，每个监听 socket
+   *        使用一个单独的线程接受新链接。不支持 SO_REUSEPORT 的平台只会使用一个监听
+   *        socket。需要在 start 之前调用
+   *
+   * @param acceptor_count 监听 socket 的个数
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_acceptor_count(uint32_t acceptor_count);
+
+  /**
+   * @brief 设置每个监听 socket 同时发起的 accept 个数，默认为1。
+   *        突发大量新链接时，增大这个值可以提高建立链接的速度。需要在 start 之前调用
+   *
+   * @param pending_accept_count 每个监听 socket 同时发起的 accept 个数
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_pending_accept_count(uint32_t pending_accept_count);
+
   /**
    * @brief
    * 设置拆包器工厂函数。收到新链接时，框架会调用这个函数为链接创建一个拆包器用于解决粘包问题，详细说明请看
@@ -93,6 +165,53 @@ public:
   tcp_server &set_assemble_creator(
       std::function<base_packet_assemble *(void)> assemble_creator);
 
+  /**
+   * @brief 设置新链接的接收缓冲区配置，不调用此方法时使用 1024 byte 的固定大小缓冲区
+   *
+   * @param policy 接收缓冲区配置
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_receive_buffer_policy(const receive_buffer_policy &policy);
+
+  /**
+   * @brief 设置新链接一次批量发送的最大字节数，默认为 64KB。
+   *        发送队列中的数据会合并到一次 async_write
+   *        中发送，这个值越大吞吐越高，单个数据的发送延迟也越高
+   *
+   * @param send_batch_max_bytes 一次批量发送的最大字节数
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_send_batch_max_bytes(uint32_t send_batch_max_bytes);
+
+  /**
+   * @brief 设置新链接的发送队列配置，包括高低水位以及字节数上限。
+   *        链接拥塞状态的变化可以通过 connection_handle::set_write_state_callback
+   *        监听
+   *
+   * @param policy 发送队列配置
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_send_buffer_policy(const send_buffer_policy &policy);
+
+  /**
+   * @brief 设置 socket 选项。SO_SNDBUF、SO_RCVBUF、TCP_DEFER_ACCEPT 和 backlog
+   *        在 listen 之前设置，其它选项在 accept 之后，开始读取数据之前设置。
+   *        需要在 start 之前调用
+   *
+   * @param option socket 选项
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_socket_option(const socket_option &option);
+
+  /**
+   * @brief 设置新链接的空闲超时和心跳配置，默认不检测。
+   *        每个传输线程使用一个时间轮检测所有链接，需要在 start 之前调用
+   *
+   * @param policy 空闲超时和心跳配置
+   * @return tcp_server& tcp_server 自己
+   */
+  tcp_server &set_heartbeat_policy(const heartbeat_policy &policy);
+
   /**
    * @brief 启动服务器
    *
@@ -108,12 +227,73 @@ public:
   void stop();
 
   /**
-   * @brief 获取监听的地址
+   * @brief 优雅关闭服务器：停止接受新链接，所有链接停止处理收到的数据，
+   *        发送完发送队列中的数据以后发送 FIN。超时以后丢弃剩下的数据并关闭链接。
+   *        不会停止后台线程，完成以后需要调用 stop。可以多次调用，
+   *        每次调用的回调都会被调用
+   *
+   * @param timeout 超时时间
+   * @param call_back 所有链接处理完成的回调，在后台线程中调用，
+   *        不能在回调中调用 stop
+   */
+  void drain(std::chrono::milliseconds timeout,
+             std::function<void(const drain_result &)> call_back);
+
+  /**
+   * @brief 优雅关闭并停止服务器，等待 drain 完成以后调用 stop。
+   *        会阻塞当前线程，不能在服务器的后台线程中调用
+   *
+   * @param timeout 超时时间
+   * @return drain_result 优雅关闭的结果
+   */
+  drain_result graceful_stop(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief 向指定链接发送数据，可以在任意线程中调用
+   *
+   * @param connection_id 链接 id，通过 connection_handle::id 获取
+   * @param data 需要发送的数据
+   * @param call_back 发送数据完成的回调，链接不存在时以 error_code::null_connection
+   * 调用
+   */
+  void send(uint64_t connection_id, std::string data,
+            std::function<void(const std::error_code &)> call_back);
+
+  /**
+   * @brief 向所有链接发送数据，可以在任意线程中调用
+   *
+   * @param data 需要发送的数据
+   * @param call_back
+   * 发送数据完成的回调，每个链接调用一次，可以从error_code参数获取是否发送成功
+   */
+  void broadcast(std::string data,
+                 std::function<void(const std::error_code &)> call_back);
+
+  /**
+   * @brief 遍历所有链接，可以在任意线程中调用。回调在调用线程中执行，
+   *        遍历过程中新建立或者断开的链接不一定会被遍历到
+   *
+   * @param call_back 遍历回调
+   */
+  void for_each(
+      const std::function<void(const std::shared_ptr<connection_handle> &)>
+          &call_back) const;
+
+  /**
+   * @brief 获取当前的链接数量
+   *
+   * @return std::size_t 链接数量
+   */
+  inline std::size_t connection_count() const { return connections_.size(); }
+
+  /**
+   * @brief 获取监听的地址，监听 unix domain socket 时为 socket 文件路径
    *
    * @return std::string 监听地址
    */
   inline std::string get_listen_address() const {
-    return listen_ip_.to_string();
+    return listen_unix_path_.empty() ? listen_ip_.to_string()
+                                     : listen_unix_path_;
   }
 
   /**
@@ -124,17 +304,60 @@ public:
   inline uint16_t get_listen_port() const { return listen_port_; }
 
 private:
-  std::error_code accept();
+  std::error_code accept(const std::shared_ptr<stream_acceptor> &acceptor);
+
+  std::error_code listen(asio::io_context &io_context, bool reuse_port,
+                         const socket_option &option);
+
+  void close_acceptors();
+
+  void handle_accepted(const std::shared_ptr<tcp_connection> &connection,
+                       uint64_t connection_id);
+
+  void drain_connections(std::chrono::milliseconds timeout,
+                         std::function<void(const drain_result &)> call_back);
+
+  void create_transfer_threads();
+
+  void create_timing_wheels();
+
+  std::shared_ptr<tcp_connection> create_connection(uint64_t connection_id);
+
+  void remove_connection(uint64_t connection_id);
 
 private:
   uint16_t listen_port_{0};
   asio::ip::address_v4 listen_ip_{asio::ip::address_v4::any()};
-  std::shared_ptr<asio::ip::tcp::acceptor> acceptor_{nullptr};
+  std::string listen_unix_path_;
+  // 保护 acceptors_，drain 可能在其它线程中调用
+  std::mutex acceptors_mutex_;
+  std::vector<std::shared_ptr<stream_acceptor>> acceptors_;
+  // 保护 accepting_count_ 和 pending_drains_
+  std::mutex accept_mutex_;
+  // 已经 accept，还在等待传输线程初始化的链接数量
+  uint32_t accepting_count_{0};
+  // 等待 accepting_count_ 变为0以后开始的 drain，可能有多次 drain 同时等待
+  std::vector<std::function<void()>> pending_drains_;
+  uint32_t acceptor_count_{1};
+  uint32_t pending_accept_count_{1};
   asio::io_context transfer_io_context_;
   asio::executor_work_guard<asio::io_context::executor_type>
       transfer_io_context_work_guard_;
   asio_io_context_thread accept_thread_;
+  std::vector<std::shared_ptr<asio_io_context_thread>> extra_accept_threads_;
   std::vector<std::shared_ptr<shared_asio_io_context_thread>> io_threads_;
+  std::vector<std::shared_ptr<asio_io_context_thread>> per_thread_io_threads_;
+  std::atomic<uint32_t> next_io_thread_{0};
+  uint32_t transfer_thread_count_{0};
+  transfer_io_mode transfer_io_mode_{transfer_io_mode::shared};
   std::function<base_packet_assemble *(void)> assemble_creator_{nullptr};
+  receive_buffer_policy receive_buffer_policy_;
+  uint32_t send_batch_max_bytes_{64 * 1024};
+  send_buffer_policy send_buffer_policy_;
+  socket_option socket_option_;
+  heartbeat_policy heartbeat_policy_;
+  std::vector<std::shared_ptr<io_timing_wheel>> timing_wheels_;
+  std::atomic<uint64_t> next_connection_id_{1};
+  connection_registry connections_;
 };
 } // namespace salt
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "salt/core/worker_pool.h"
+
+#include <exception>
+
+#include "salt/core/log.h"
+
+namespace salt {
+
+static thread_local const worker_pool *current_pool{nullptr};
+static thread_local uint32_t current_queue{0};
+
+worker_pool::worker_pool(uint32_t thread_count /* = 0 */) {
+  if (thread_count == 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  if (thread_count == 0) {
+    log_info("can not detect hardware concurrency, use 1 worker thread");
+    thread_count = 1;
+  }
+
+  for (auto i = 0u; i < thread_count; ++i) {
+    queues_.emplace_back(new task_queue());
+  }
+  for (auto i = 0u; i < thread_count; ++i) {
+    threads_.emplace_back([this, i] { run(i); });
+  }
+}
+
+worker_pool::~worker_pool() { stop(); }
+
+void worker_pool::post(std::function<void()> task) {
+  if (!task) {
+    return;
+  }
+
+  auto in_pool = current_pool == this;
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    // 停止以后线程池自己的线程仍然可以提交任务，保证串行队列能执行完
+    if (stopped_ && !in_pool) {
+      log_error("worker pool stopped, drop task");
+      return;
+    }
+  }
+
+  auto index = in_pool ? current_queue
+                       : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                             queues_.size();
+  {
+    auto &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex_);
+    // 在队列锁内计数，取出任务以后的减一不会早于这里的加一
+    pending_tasks_.fetch_add(1, std::memory_order_relaxed);
+    queue.tasks_.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    post_seq_.fetch_add(1, std::memory_order_release);
+  }
+  wait_condition_.notify_one();
+}
+
+void worker_pool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    stopped_ = true;
+  }
+  wait_condition_.notify_all();
+  for (auto &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void worker_pool::run(uint32_t index) {
+  current_pool = this;
+  current_queue = index;
+  while (true) {
+    // 取任务之前记录提交序号，等待时只要有新提交的任务就不会睡眠
+    auto seq = post_seq_.load(std::memory_order_acquire);
+    std::function<void()> task;
+    if (pop(index, task) || steal(index, task)) {
+      pending_tasks_.fetch_sub(1, std::memory_order_acq_rel);
+      try {
+        task();
+      } catch (std::exception &e) {
+        log_error("worker task throw exception:%s", e.what());
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    // pop 和 steal 已经检查过所有队列，这里等待新任务而不是空转
+    wait_condition_.wait(lock, [this, seq] {
+      return stopped_ || post_seq_.load(std::memory_order_relaxed) != seq;
+    });
+    if (stopped_ && pending_tasks_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+bool worker_pool::pop(uint32_t index, std::function<void()> &task) {
+  auto &queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex_);
+  if (queue.tasks_.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks_.front());
+  queue.tasks_.pop_front();
+  return true;
+}
+
+bool worker_pool::steal(uint32_t index, std::function<void()> &task) {
+  // 先用 try_to_lock 避免和其它线程争抢，有队列被锁住时再阻塞地检查一次。
+  // 被唤醒的线程可能不是任务所在队列的线程，不能因为锁被占用就去睡眠
+  bool busy{false};
+  for (auto blocking : {false, true}) {
+    for (auto i = 1u; i < queues_.size(); ++i) {
+      auto &queue = *queues_[(index + i) % queues_.size()];
+      std::unique_lock<std::mutex> lock(queue.mutex_, std::defer_lock);
+      if (blocking) {
+        lock.lock();
+      } else if (!lock.try_lock()) {
+        busy = true;
+        continue;
+      }
+      if (queue.tasks_.empty()) {
+        continue;
+      }
+      task = std::move(queue.tasks_.back());
+      queue.tasks_.pop_back();
+      return true;
+    }
+    if (!busy) {
+      break;
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<worker_serial_queue>
+worker_serial_queue::create(worker_pool &pool) {
+  return std::shared_ptr<worker_serial_queue>(new worker_serial_queue(pool));
+}
+
+void worker_serial_queue::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (scheduled_) {
+      return;
+    }
+    scheduled_ = true;
+  }
+  pool_.post([self = shared_from_this()] { self->drain(); });
+}
+
+void worker_serial_queue::drain() {
+  for (auto i = 0u; i < max_tasks_per_drain_; ++i) {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (tasks_.empty()) {
+        scheduled_ = false;
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    try {
+      task();
+    } catch (std::exception &e) {
+      log_error("serial task throw exception:%s", e.what());
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+      scheduled_ = false;
+      return;
+    }
+  }
+  pool_.post([self = shared_from_this()] { self->drain(); });
+}
+
+} // namespace salt
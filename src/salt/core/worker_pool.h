@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace salt {
+
+/**
+ * @brief 业务线程池。每个线程有自己的任务队列，自己的队列空了以后会从其它线程的队列中偷任务，
+ *        用来把耗时的业务逻辑从网络线程中移出去
+ *
+ */
+class worker_pool {
+public:
+  /**
+   * @brief 创建线程池并启动线程
+   *
+   * @param thread_count 线程数量，为 0 时使用 std::thread::hardware_concurrency
+   */
+  explicit worker_pool(uint32_t thread_count = 0);
+
+  /**
+   * @brief 执行完已经提交的任务以后停止所有线程
+   *
+   */
+  ~worker_pool();
+
+  worker_pool(const worker_pool &) = delete;
+  worker_pool &operator=(const worker_pool &) = delete;
+
+  /**
+   * @brief 提交一个任务。在线程池的线程中提交的任务会放到当前线程的队列，
+   *        其它线程提交的任务轮流放到各个线程的队列
+   *
+   * @param task 需要执行的任务
+   */
+  void post(std::function<void()> task);
+
+  /**
+   * @brief 执行完已经提交的任务以后停止所有线程，停止以后提交的任务会被丢弃
+   *
+   */
+  void stop();
+
+  /**
+   * @brief 获取线程数量
+   *
+   * @return uint32_t 线程数量
+   */
+  inline uint32_t thread_count() const {
+    return static_cast<uint32_t>(threads_.size());
+  }
+
+private:
+  struct task_queue {
+    std::mutex mutex_;
+    std::deque<std::function<void()>> tasks_;
+  };
+
+  void run(uint32_t index);
+  bool pop(uint32_t index, std::function<void()> &task);
+  bool steal(uint32_t index, std::function<void()> &task);
+
+private:
+  std::vector<std::unique_ptr<task_queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<uint32_t> next_queue_{0};
+  std::atomic<std::size_t> pending_tasks_{0};
+  // 每次提交任务加一，在 wait_mutex_ 中修改
+  std::atomic<uint64_t> post_seq_{0};
+  std::mutex wait_mutex_;
+  std::condition_variable wait_condition_;
+  bool stopped_{false};
+};
+
+/**
+ * @brief 在 worker_pool 上按提交顺序串行执行任务的队列。
+ *        不同的队列之间可以并行执行，通常每个链接使用一个队列来保证同一个链接的包按顺序处理
+ *
+ */
+class worker_serial_queue
+    : public std::enable_shared_from_this<worker_serial_queue> {
+public:
+  /**
+   * @brief 创建串行队列
+   *
+   * @param pool 执行任务的线程池，生命周期需要比队列中的任务长
+   * @return std::shared_ptr<worker_serial_queue> 创建的串行队列
+   */
+  static std::shared_ptr<worker_serial_queue> create(worker_pool &pool);
+
+  /**
+   * @brief 提交一个任务，同一个队列中的任务按照提交顺序依次执行
+   *
+   * @param task 需要执行的任务
+   */
+  void post(std::function<void()> task);
+
+private:
+  explicit worker_serial_queue(worker_pool &pool) : pool_(pool) {}
+
+  void drain();
+
+private:
+  /**
+   * <!-- 让 doxygen 忽略这段话
+   * 每次最多连续执行这么多任务，然后把剩下的重新提交到线程池，
+   * 避免一个繁忙的链接一直占着一个线程
+   * -->
+   */
+  static constexpr std::size_t max_tasks_per_drain_{16};
+
+  worker_pool &pool_;
+  std::mutex mutex_;
+  std::deque<std::function<void()>> tasks_;
+  bool scheduled_{false};
+};
+
+} // namespace salt
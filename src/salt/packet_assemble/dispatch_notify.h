@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "salt/core/log.h"
+#include "salt/core/worker_pool.h"
+#include "salt/packet_assemble/header_body_assemble.h"
+
+namespace salt {
+
+/**
+ * @brief 把拆包完成的回调转到业务线程池中执行的 notify，避免耗时的业务逻辑阻塞网络线程。
+ *        每个 dispatch_notify 有自己的串行队列，同一个链接（同一个拆包器）
+ *        的包按照收到的顺序处理
+ *
+ *        header_read_finish 仍然在网络线程中同步调用，以便在收包体之前校验包头；
+ *        packet_reserved 和 packet_read_error 在线程池中调用。
+ *        header_read_finish 可能与 packet_reserved 同时在两个线程中执行，
+ *        只能做不依赖 notify 内部状态的校验，notify 的状态只能在
+ *        packet_reserved 和 packet_read_error 中访问。由于调用是异步的，
+ *        packet_reserved 返回 data_read_result::disconnect 时通过
+ *        connection_handle::close 断开链接
+ *
+ * @tparam header_type 包头类型，与 header_body_assemble 的包头类型一致
+ */
+template <typename header_type>
+class dispatch_notify final
+    : public header_body_assemble_notify<header_type> {
+public:
+  /**
+   * @brief 创建 dispatch_notify
+   *
+   * @param pool 执行回调的线程池，生命周期需要比链接长
+   * @param notify 实际处理包的 notify
+   */
+  dispatch_notify(
+      worker_pool &pool,
+      std::unique_ptr<header_body_assemble_notify<header_type>> notify)
+      : notify_(std::move(notify)), queue_(worker_serial_queue::create(pool)) {}
+
+  data_read_result
+  packet_reserved(std::shared_ptr<connection_handle> connection,
+                  std::string raw_header_data, std::string body) override {
+    queue_->post([notify = notify_, connection = std::move(connection),
+                  raw_header_data = std::move(raw_header_data),
+                  body = std::move(body)]() mutable {
+      auto result = notify->packet_reserved(connection,
+                                            std::move(raw_header_data),
+                                            std::move(body));
+      if (result == data_read_result::disconnect && connection) {
+        log_error("packet_reserved return disconnect in worker, close "
+                  "connection");
+        connection->close();
+      }
+    });
+    return data_read_result::success;
+  }
+
+  data_read_result
+  header_read_finish(std::shared_ptr<connection_handle> connection,
+                     const std::string &raw_header_data) override {
+    return notify_->header_read_finish(std::move(connection), raw_header_data);
+  }
+
+  void packet_read_error(const std::error_code &error_code,
+                         const std::string &message) override {
+    queue_->post([notify = notify_, error_code, message] {
+      notify->packet_read_error(error_code, message);
+    });
+  }
+
+private:
+  std::shared_ptr<header_body_assemble_notify<header_type>> notify_;
+  std::shared_ptr<worker_serial_queue> queue_;
+};
+
+/**
+ * @brief 创建在线程池中执行回调的 notify，用法：
+ *        assemble->set_notify(salt::make_dispatch_notify<header_type>(
+ *            pool, std::make_unique<my_notify>()));
+ *
+ * @tparam header_type 包头类型
+ * @param pool 执行回调的线程池，生命周期需要比链接长
+ * @param notify 实际处理包的 notify
+ * @return std::unique_ptr<header_body_assemble_notify<header_type>> notify
+ */
+template <typename header_type>
+std::unique_ptr<header_body_assemble_notify<header_type>>
+make_dispatch_notify(
+    worker_pool &pool,
+    std::unique_ptr<header_body_assemble_notify<header_type>> notify) {
+  return std::make_unique<dispatch_notify<header_type>>(pool,
+                                                        std::move(notify));
+}
+
+} // namespace salt
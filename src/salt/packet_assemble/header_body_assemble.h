@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <type_traits>
 
 #include "salt/core/error.h"
@@ -143,13 +144,26 @@ public:
   data_read_result data_received(std::shared_ptr<connection_handle> connection,
                                  std::string s) override final;
 
+  /**
+   * @brief socket 链接读取到数据时的回调，在使用这个类时，用户不需要关注此方法。
+   *        只会拷贝组包需要保留的数据
+   *
+   * @param connection 读取到数据的链接
+   * @param s 读取到的数据，指向链接的接收缓冲区
+   * @return data_read_result 处理数据的结果
+   */
+  data_read_result data_received(std::shared_ptr<connection_handle> connection,
+                                 std::string_view s) override final;
+
   ~header_body_assemble() = default;
 
 private:
   std::string header_;
   std::string body_;
   static constexpr uint32_t header_size_ = sizeof(header_type);
-  using size_type = decltype(std::declval<header_type>().*length_property);
+  // 对右值使用 .* 得到的是引用类型，需要去掉引用，否则 body_size_ 会绑定到临时变量
+  using size_type = std::remove_reference_t<decltype(
+      std::declval<header_type>().*length_property)>;
   size_type body_size_{0};
 
   enum class parse_stat {
@@ -170,6 +184,13 @@ template <typename header_type, auto length_property>
 data_read_result
 header_body_assemble<header_type, length_property>::data_received(
     std::shared_ptr<connection_handle> connection, std::string s) {
+  return data_received(std::move(connection), std::string_view{s});
+}
+
+template <typename header_type, auto length_property>
+data_read_result
+header_body_assemble<header_type, length_property>::data_received(
+    std::shared_ptr<connection_handle> connection, std::string_view s) {
 
   auto check_size = [this](uint32_t reserve_size) {
     if (body_size_ < reserve_size) {
@@ -230,6 +251,8 @@ header_body_assemble<header_type, length_property>::data_received(
     return data_read_result::success;
   };
 
+  // 某个包的回调返回 error 时继续拆后面的包，最后把 error 返回给链接
+  auto read_result = data_read_result::success;
   uint32_t offset{0};
   auto rest_data_length = s.size();
   while (offset < s.size()) {
@@ -239,7 +262,7 @@ header_body_assemble<header_type, length_property>::data_received(
         rest_length_ -= rest_data_length;
         header_ += s.substr(offset);
         current_stat_ = parse_stat::header;
-        return data_read_result::success;
+        return read_result;
       } else if (rest_length_ == rest_data_length) {
         header_ += s.substr(offset);
         rest_data_length -= rest_length_;
@@ -285,7 +308,7 @@ header_body_assemble<header_type, length_property>::data_received(
          * -->
          */
         if (body_size_ != 0) {
-          return data_read_result::success;
+          return read_result;
         }
       } else /* if (rest_length_ < rest_data_length) */ {
         rest_data_length -= rest_length_;
@@ -333,42 +356,56 @@ header_body_assemble<header_type, length_property>::data_received(
         body_ += s.substr(offset);
         rest_length_ -= rest_data_length;
         current_stat_ = parse_stat::body;
-        return data_read_result::success;
+        return read_result;
       } else if (rest_data_length == rest_length_) {
         body_ += s.substr(offset);
         log_debug("get message body size:%llu, content:%s", body_size_,
                   body_.c_str());
+        auto packet_result = data_read_result::success;
         if (notify_) {
-          notify_->packet_reserved(connection, std::move(header_),
-                                   std::move(body_));
+          packet_result = notify_->packet_reserved(
+              connection, std::move(header_), std::move(body_));
         }
         current_stat_ = parse_stat::header;
         rest_length_ = header_size_;
         header_.clear();
         body_.clear();
         body_size_ = 0;
-        return data_read_result::success;
+        // 回调要求断开链接时不再处理剩下的数据
+        if (packet_result == data_read_result::disconnect) {
+          return packet_result;
+        } else if (packet_result == data_read_result::error) {
+          read_result = packet_result;
+        }
+        return read_result;
       } else /* if (rest_data_length > rest_length_) */ {
         rest_data_length -= rest_length_;
         body_ += s.substr(offset, rest_length_);
         offset += rest_length_;
         log_debug("get message body size:%llu, content:%s", body_size_,
                   body_.c_str());
+        auto packet_result = data_read_result::success;
         if (notify_) {
-          notify_->packet_reserved(connection, std::move(header_),
-                                   std::move(body_));
+          packet_result = notify_->packet_reserved(
+              connection, std::move(header_), std::move(body_));
         }
         current_stat_ = parse_stat::header;
         rest_length_ = header_size_;
         header_.clear();
         body_.clear();
         body_size_ = 0;
+        // 回调要求断开链接时不再处理剩下的数据
+        if (packet_result == data_read_result::disconnect) {
+          return packet_result;
+        } else if (packet_result == data_read_result::error) {
+          read_result = packet_result;
+        }
       }
     } break;
     }
   }
 
-  return data_read_result::success;
+  return read_result;
 }
 
 } // namespace salt
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "salt/core/connection_handle.h"
 
@@ -32,7 +33,11 @@ enum class data_read_result {
 };
 
 /**
- * @brief 拆包器接口，使用者需要继承这个类，并且实现 data_received 方法
+ * @brief 拆包器接口，使用者需要继承这个类，并且实现 data_received 方法。
+ *        data_received 有 std::string 和 std::string_view 两个重载，
+ *        只 override 其中一个时，需要在子类中声明
+ *        using base_packet_assemble::data_received;
+ *        否则另一个重载会被隐藏（-Woverloaded-virtual）
  *
  */
 class base_packet_assemble {
@@ -49,6 +54,22 @@ public:
   data_received(std::shared_ptr<connection_handle> connection,
                 std::string s) = 0;
 
+  /**
+   * @brief 当tcp链接有数据读取时，salt 实际调用的是这个方法。
+   *        s 直接指向链接的接收缓冲区，仅在本次调用期间有效，拆包器需要自行拷贝需要保留的数据。
+   *        默认实现会将数据拷贝为 std::string 后调用 data_received(connection, std::string)，
+   *        如果拆包器可以直接处理 string_view，override 这个方法可以省掉一次内存分配和拷贝
+   *
+   * @param connection 读取到数据的 socket 链接
+   * @param s 读取到的数据，指向接收缓冲区
+   * @return data_read_result 数据的处理结果
+   */
+  virtual data_read_result
+  data_received(std::shared_ptr<connection_handle> connection,
+                std::string_view s) {
+    return data_received(std::move(connection), std::string{s});
+  }
+
   virtual ~base_packet_assemble() = default;
 };
 
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+#include "asio.hpp"
+#include "salt/core/connection_handle.h"
+#include "salt/core/log.h"
+#include "salt/packet_assemble/header_body_assemble.h"
+
+namespace salt {
+
+/**
+ * @brief 拆包器拆出来的一个完整的包
+ *
+ */
+struct packet {
+  /**
+   * @brief 收到包的链接，可以使用这个链接发回包
+   *
+   */
+  std::shared_ptr<connection_handle> connection;
+
+  /**
+   * @brief 包头原始数据
+   *
+   */
+  std::string raw_header_data;
+
+  /**
+   * @brief 包内容原始数据
+   *
+   */
+  std::string body;
+};
+
+/**
+ * @brief 把拆包器的回调转换成可以等待的包队列，可以配合 asio::use_awaitable
+ *        在 C++20 协程中逐个读取包：
+ *        auto p = co_await channel->async_next_packet(asio::use_awaitable);
+ *
+ *        通过 make_notify 创建拆包器的 notify，拆出来的包会放入队列。
+ *        async_next_packet 在队列为空时挂起，收到包以后通过 token 关联的
+ *        executor 恢复执行。线程安全
+ *
+ * @tparam header_type 包头类型，与 header_body_assemble 的包头类型一致
+ */
+template <typename header_type>
+class packet_channel
+    : public std::enable_shared_from_this<packet_channel<header_type>> {
+public:
+  /**
+   * @brief 创建 packet_channel
+   *
+   * @param max_pending_packets 队列中最多缓存多少个包，超过以后拆包器会返回
+   * data_read_result::disconnect 断开链接。为 0 时不限制
+   * @return std::shared_ptr<packet_channel> 创建的 packet_channel
+   */
+  static std::shared_ptr<packet_channel>
+  create(std::size_t max_pending_packets = 0) {
+    return std::shared_ptr<packet_channel>(
+        new packet_channel(max_pending_packets));
+  }
+
+  /**
+   * @brief 创建把包放入本队列的拆包器 notify，配合
+   * header_body_assemble::set_notify 使用
+   *
+   * @return std::unique_ptr<header_body_assemble_notify<header_type>> notify
+   */
+  std::unique_ptr<header_body_assemble_notify<header_type>> make_notify() {
+    return std::make_unique<channel_notify>(this->shared_from_this());
+  }
+
+  /**
+   * @brief 读取下一个包，完成签名为 void(std::error_code, packet)。
+   *        同一时间只能有一个等待中的读取，重复读取会以
+   *        asio::error::in_progress 完成；队列关闭后以 close 的错误码完成
+   *
+   * @tparam completion_token asio completion token 类型
+   * @param token asio completion token，比如 asio::use_awaitable 或者回调函数
+   * @return 取决于 completion_token，asio::use_awaitable 时为
+   * asio::awaitable<packet>
+   */
+  template <typename completion_token>
+  auto async_next_packet(completion_token &&token) {
+    return asio::async_initiate<completion_token,
+                                void(std::error_code, packet)>(
+        [this](auto handler) {
+          std::unique_lock<std::mutex> lock(mutex_);
+          if (!packets_.empty()) {
+            auto p = std::move(packets_.front());
+            packets_.pop_front();
+            lock.unlock();
+            complete(std::move(handler), std::error_code{}, std::move(p));
+          } else if (close_reason_) {
+            auto reason = close_reason_;
+            lock.unlock();
+            complete(std::move(handler), reason, packet{});
+          } else if (waiter_) {
+            lock.unlock();
+            complete(std::move(handler),
+                     asio::error::make_error_code(asio::error::in_progress),
+                     packet{});
+          } else {
+            waiter_ = std::make_unique<waiter<decltype(handler)>>(
+                std::move(handler));
+          }
+        },
+        token);
+  }
+
+  /**
+   * @brief 把一个包放入队列，通常由 make_notify 创建的 notify 调用
+   *
+   * @param p 收到的包
+   * @return true 放入成功
+   * @return false 队列已满或者已经关闭
+   */
+  bool push(packet p) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (close_reason_) {
+      return false;
+    }
+    if (waiter_) {
+      auto waiting = std::move(waiter_);
+      lock.unlock();
+      waiting->complete(std::error_code{}, std::move(p));
+      return true;
+    }
+    if (max_pending_packets_ != 0 &&
+        packets_.size() >= max_pending_packets_) {
+      log_error("packet channel full, max pending packets:%zu",
+                max_pending_packets_);
+      return false;
+    }
+    packets_.push_back(std::move(p));
+    return true;
+  }
+
+  /**
+   * @brief 关闭队列。队列中剩下的包仍然可以读取，读完以后的读取以 reason 完成。
+   *        通常在 tcp_client_notify::connection_disconnected 中调用
+   *
+   * @param reason 关闭原因，默认为 asio::error::eof
+   */
+  void close(std::error_code reason = asio::error::make_error_code(
+                 asio::error::eof)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (close_reason_) {
+      return;
+    }
+    close_reason_ = reason;
+    auto waiting = std::move(waiter_);
+    lock.unlock();
+    if (waiting) {
+      waiting->complete(reason, packet{});
+    }
+  }
+
+  /**
+   * @brief 获取队列中缓存的包的数量
+   *
+   * @return std::size_t 队列中包的数量
+   */
+  std::size_t pending_packets() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return packets_.size();
+  }
+
+private:
+  explicit packet_channel(std::size_t max_pending_packets)
+      : max_pending_packets_(max_pending_packets) {}
+
+  template <typename handler_type>
+  static void complete(handler_type handler, std::error_code err_code,
+                       packet p) {
+    auto executor = asio::get_associated_executor(handler);
+    asio::post(executor, [handler = std::move(handler), err_code,
+                          p = std::move(p)]() mutable {
+      handler(err_code, std::move(p));
+    });
+  }
+
+  class waiter_base {
+  public:
+    virtual void complete(std::error_code err_code, packet p) = 0;
+    virtual ~waiter_base() = default;
+  };
+
+  /**
+   * <!-- 让 doxygen 忽略这段话
+   * asio 的 handler 只能移动，不能放进 std::function，这里自己做一次类型擦除
+   * -->
+   */
+  template <typename handler_type> class waiter final : public waiter_base {
+  public:
+    explicit waiter(handler_type &&handler)
+        : handler_(std::move(handler)),
+          work_(asio::make_work_guard(
+              asio::get_associated_executor(handler_))) {}
+
+    void complete(std::error_code err_code, packet p) override {
+      packet_channel::complete(std::move(handler_), err_code, std::move(p));
+      work_.reset();
+    }
+
+  private:
+    handler_type handler_;
+    asio::executor_work_guard<asio::associated_executor_t<handler_type>> work_;
+  };
+
+  class channel_notify final
+      : public header_body_assemble_notify<header_type> {
+  public:
+    explicit channel_notify(std::shared_ptr<packet_channel> channel)
+        : channel_(std::move(channel)) {}
+
+    data_read_result
+    packet_reserved(std::shared_ptr<connection_handle> connection,
+                    std::string raw_header_data, std::string body) override {
+      if (!channel_->push(packet{std::move(connection),
+                                 std::move(raw_header_data),
+                                 std::move(body)})) {
+        return data_read_result::disconnect;
+      }
+      return data_read_result::success;
+    }
+
+  private:
+    std::shared_ptr<packet_channel> channel_;
+  };
+
+private:
+  mutable std::mutex mutex_;
+  std::deque<packet> packets_;
+  std::unique_ptr<waiter_base> waiter_;
+  std::error_code close_reason_;
+  std::size_t max_pending_packets_{0};
+};
+
+} // namespace salt
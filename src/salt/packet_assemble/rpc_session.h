@@ -0,0 +1,383 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "asio.hpp"
+#include "salt/core/connection_handle.h"
+#include "salt/core/error.h"
+#include "salt/core/io_timing_wheel.h"
+#include "salt/core/log.h"
+#include "salt/packet_assemble/header_body_assemble.h"
+#include "salt/packet_assemble/packet_channel.h"
+#include "salt/util/byte_order.h"
+#include "salt/util/call_back_wrapper.h"
+#include "salt/util/id_table.h"
+
+namespace salt {
+
+/**
+ * @brief 请求-响应关联层。发送请求时在包头的 id_property 字段中写入请求 id，
+ *        收到的包按照同一个字段找到等待中的请求并完成，一个链接上可以同时有
+ *        多个未完成的请求。对端回包时需要原样带回这个字段
+ *
+ *        通过 make_notify 创建拆包器的 notify，没有对应请求的包（比如对端主动推送）
+ *        交给 make_notify 传入的 notify 处理。请求超时由时间轮驱动，
+ *        不会为每个请求创建定时器。线程安全
+ *
+ * @tparam header_type 包头类型，与 header_body_assemble 的包头类型一致
+ * @tparam id_property 包头中表示请求 id 的字段，网络字节序
+ */
+template <typename header_type, auto id_property>
+class rpc_session : public std::enable_shared_from_this<
+                        rpc_session<header_type, id_property>> {
+public:
+  using id_type = std::remove_reference_t<decltype(
+      std::declval<header_type>().*id_property)>;
+
+  /**
+   * @brief 请求完成的回调，成功时 packet 为收到的响应
+   *
+   */
+  using response_callback =
+      std::function<void(const std::error_code &error_code, packet response)>;
+
+  /**
+   * @brief 创建 rpc_session
+   *
+   * @param timing_wheel 驱动请求超时的时间轮，需要已经调用 start
+   * @return std::shared_ptr<rpc_session> 创建的 rpc_session
+   */
+  static std::shared_ptr<rpc_session>
+  create(std::shared_ptr<io_timing_wheel> timing_wheel) {
+    return std::shared_ptr<rpc_session>(
+        new rpc_session(std::move(timing_wheel)));
+  }
+
+  /**
+   * @brief 创建按照请求 id 完成请求的拆包器 notify，配合
+   * header_body_assemble::set_notify 使用
+   *
+   * @param notify 处理没有对应请求的包的 notify，可以为空
+   * @return std::unique_ptr<header_body_assemble_notify<header_type>> notify
+   */
+  std::unique_ptr<header_body_assemble_notify<header_type>> make_notify(
+      std::unique_ptr<header_body_assemble_notify<header_type>> notify =
+          nullptr) {
+    return std::make_unique<rpc_notify>(this->shared_from_this(),
+                                        std::move(notify));
+  }
+
+  /**
+   * @brief 发送请求
+   *
+   * @param connection 发送请求的链接
+   * @param header 请求的包头，需要填好包内容长度等字段，id_property 字段会被覆盖
+   * @param body 请求的包内容
+   * @param timeout 超时时间，超时以后以 error_code::request_timeout 完成。
+   *        为0时不超时
+   * @param call_back 请求完成的回调，有且仅有一次调用。发送失败时以发送的错误码完成。
+   *        所有请求 id 都在使用中时以 error_code::too_many_requests 完成，
+   *        在收到响应的传输线程或者时间轮的线程中调用
+   */
+  void call(std::shared_ptr<connection_handle> connection, header_type header,
+            std::string body, std::chrono::milliseconds timeout,
+            response_callback call_back) {
+    id_type id{0};
+    bool exhausted{false};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // 除0以外的 id 都在使用中，包头的 id 字段较窄时可能出现。
+      // 否则 id 回绕以后跳过0和还没有完成的请求，循环一定会结束
+      exhausted = pending_.size() >= std::numeric_limits<id_type>::max();
+      if (!exhausted) {
+        do {
+          id = ++next_id_;
+        } while (id == 0 || pending_.find(id));
+
+        pending_request request;
+        request.connection = connection;
+        request.call_back = std::move(call_back);
+        if (timeout.count() > 0) {
+          request.timer_id = timing_wheel_->add(
+              timeout, [weak_this = this->weak_from_this(), id] {
+                if (auto _this = weak_this.lock(); _this) {
+                  _this->_complete(
+                      id, make_error_code(error_code::request_timeout));
+                }
+              });
+        }
+        pending_.insert(id, std::move(request));
+      }
+    }
+    if (exhausted) {
+      log_error("too many pending requests, no request id available");
+      salt::call(call_back, make_error_code(error_code::too_many_requests),
+                 packet{});
+      return;
+    }
+
+    header.*id_property = byte_order::to_network(id);
+    std::string data;
+    data.reserve(sizeof(header_type) + body.size());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header_type));
+    data.append(body);
+    connection->send(std::move(data),
+                     [weak_this = this->weak_from_this(),
+                      id](const std::error_code &err_code) {
+                       if (!err_code) {
+                         return;
+                       }
+                       if (auto _this = weak_this.lock(); _this) {
+                         _this->_complete(id, err_code);
+                       }
+                     });
+  }
+
+  /**
+   * @brief 基于 asio completion token 的请求接口，完成签名为
+   *        void(std::error_code, packet)。可以配合 asio::use_future 或者
+   *        asio::use_awaitable 使用：
+   *        auto response = co_await session->async_call(
+   *            connection, header, body, timeout, asio::use_awaitable);
+   *
+   * @tparam completion_token asio completion token 类型
+   * @param connection 发送请求的链接
+   * @param header 请求的包头，详细说明请看 call
+   * @param body 请求的包内容
+   * @param timeout 超时时间，为0时不超时
+   * @param token asio completion token
+   * @return 取决于 completion_token，asio::use_awaitable 时为
+   * asio::awaitable<packet>
+   */
+  template <typename completion_token>
+  auto async_call(std::shared_ptr<connection_handle> connection,
+                  header_type header, std::string body,
+                  std::chrono::milliseconds timeout, completion_token &&token) {
+    return asio::async_initiate<completion_token,
+                                void(std::error_code, packet)>(
+        [this](auto handler, std::shared_ptr<connection_handle> connection,
+               header_type header, std::string body,
+               std::chrono::milliseconds timeout) {
+          using handler_type = decltype(handler);
+          struct call_operation {
+            explicit call_operation(handler_type &&handler)
+                : handler_(std::move(handler)),
+                  work_(asio::make_work_guard(
+                      asio::get_associated_executor(handler_))) {}
+
+            handler_type handler_;
+            asio::executor_work_guard<
+                asio::associated_executor_t<handler_type>>
+                work_;
+          };
+
+          // response_callback 需要可拷贝，这里只分配一次共享状态
+          auto operation =
+              std::make_shared<call_operation>(std::move(handler));
+          call(std::move(connection), header, std::move(body), timeout,
+               [operation](const std::error_code &err_code, packet response) {
+                 auto executor = operation->work_.get_executor();
+                 asio::dispatch(executor, [operation, err_code,
+                                           response = std::move(
+                                               response)]() mutable {
+                   auto handler = std::move(operation->handler_);
+                   operation->work_.reset();
+                   handler(err_code, std::move(response));
+                 });
+               });
+        },
+        token, std::move(connection), header, std::move(body), timeout);
+  }
+
+  /**
+   * @brief 以 reason 完成在 connection 上发送的所有未完成的请求，
+   *        不影响其它链接上的请求。通常在链接断开时调用，
+   *        否则这个链接上没有设置超时的请求会一直等待
+   *
+   * @param connection 断开的链接
+   * @param reason 完成的错误码，默认为 asio::error::operation_aborted
+   */
+  void cancel(const std::shared_ptr<connection_handle> &connection,
+              std::error_code reason = asio::error::make_error_code(
+                  asio::error::operation_aborted)) {
+    std::vector<pending_request> requests;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::vector<uint64_t> ids;
+      pending_.for_each([&](uint64_t id, pending_request &request) {
+        if (_same_connection(request, connection)) {
+          ids.push_back(id);
+          requests.push_back(std::move(request));
+        }
+      });
+      for (auto id : ids) {
+        pending_.erase(id);
+      }
+    }
+
+    for (auto &request : requests) {
+      _finish(request, reason, packet{});
+    }
+  }
+
+  /**
+   * @brief 以 reason 完成所有未完成的请求，通常在停止客户端时调用
+   *
+   * @param reason 完成的错误码，默认为 asio::error::operation_aborted
+   */
+  void cancel_all(std::error_code reason = asio::error::make_error_code(
+                      asio::error::operation_aborted)) {
+    std::vector<pending_request> requests;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests.reserve(pending_.size());
+      pending_.for_each([&requests](uint64_t, pending_request &request) {
+        requests.push_back(std::move(request));
+      });
+      pending_.clear();
+    }
+
+    for (auto &request : requests) {
+      _finish(request, reason, packet{});
+    }
+  }
+
+  /**
+   * @brief 获取未完成的请求数量
+   *
+   * @return std::size_t 未完成的请求数量
+   */
+  std::size_t pending_requests() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+  }
+
+private:
+  explicit rpc_session(std::shared_ptr<io_timing_wheel> timing_wheel)
+      : timing_wheel_(std::move(timing_wheel)) {}
+
+  struct pending_request {
+    std::weak_ptr<connection_handle> connection;
+    response_callback call_back;
+    timing_wheel::timer_id timer_id{0};
+  };
+
+  bool _take(id_type id, pending_request &request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = pending_.find(id);
+    if (!found) {
+      return false;
+    }
+    request = std::move(*found);
+    pending_.erase(id);
+    return true;
+  }
+
+  /**
+   * @brief 取出在 connection 上发送的请求，其它链接上发送的请求即使 id
+   *        相同也不会被取出
+   *
+   */
+  bool _take(id_type id, const std::shared_ptr<connection_handle> &connection,
+             pending_request &request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = pending_.find(id);
+    if (!found || !_same_connection(*found, connection)) {
+      return false;
+    }
+    request = std::move(*found);
+    pending_.erase(id);
+    return true;
+  }
+
+  static bool
+  _same_connection(const pending_request &request,
+                   const std::shared_ptr<connection_handle> &connection) {
+    // 比较控制块而不是地址，链接释放以后地址可能被新的链接复用
+    return !request.connection.owner_before(connection) &&
+           !connection.owner_before(request.connection);
+  }
+
+  void _finish(pending_request &request, const std::error_code &err_code,
+               packet response) {
+    if (request.timer_id != 0) {
+      timing_wheel_->cancel(request.timer_id);
+    }
+    salt::call(request.call_back, err_code, std::move(response));
+  }
+
+  void _complete(id_type id, const std::error_code &err_code) {
+    pending_request request;
+    if (_take(id, request)) {
+      _finish(request, err_code, packet{});
+    }
+  }
+
+  class rpc_notify final : public header_body_assemble_notify<header_type> {
+  public:
+    rpc_notify(std::shared_ptr<rpc_session> session,
+               std::unique_ptr<header_body_assemble_notify<header_type>> notify)
+        : session_(std::move(session)), notify_(std::move(notify)) {}
+
+    data_read_result
+    packet_reserved(std::shared_ptr<connection_handle> connection,
+                    std::string raw_header_data, std::string body) override {
+      auto id =
+          byte_order::to_host(this->to_header(raw_header_data).*id_property);
+      pending_request request;
+      // 只完成在收到响应的链接上发送的请求，其它链接上的 id 可能相同
+      if (session_->_take(id, connection, request)) {
+        session_->_finish(request, std::error_code{},
+                          packet{std::move(connection),
+                                 std::move(raw_header_data), std::move(body)});
+        return data_read_result::success;
+      }
+
+      if (notify_) {
+        return notify_->packet_reserved(std::move(connection),
+                                        std::move(raw_header_data),
+                                        std::move(body));
+      }
+      log_debug("no pending request for id %llu, drop packet",
+                static_cast<unsigned long long>(id));
+      return data_read_result::success;
+    }
+
+    data_read_result
+    header_read_finish(std::shared_ptr<connection_handle> connection,
+                       const std::string &raw_header_data) override {
+      if (notify_) {
+        return notify_->header_read_finish(std::move(connection),
+                                           raw_header_data);
+      }
+      return data_read_result::success;
+    }
+
+    void packet_read_error(const std::error_code &error_code,
+                           const std::string &message) override {
+      if (notify_) {
+        notify_->packet_read_error(error_code, message);
+      }
+    }
+
+  private:
+    std::shared_ptr<rpc_session> session_;
+    std::unique_ptr<header_body_assemble_notify<header_type>> notify_;
+  };
+
+private:
+  std::shared_ptr<io_timing_wheel> timing_wheel_;
+  mutable std::mutex mutex_;
+  id_type next_id_{0};
+  id_table<pending_request> pending_;
+};
+
+} // namespace salt
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace salt {
+
+/**
+ * @brief 以 uint64_t id 为 key 的开放寻址哈希表，使用线性探测，删除时向前移动后续元素，
+ *        不留墓碑。id 0 保留为空位，不能作为 key。value_type 需要可以默认构造。
+ *        不是线程安全的
+ *
+ * @tparam value_type 值类型
+ */
+template <typename value_type> class id_table {
+public:
+  explicit id_table(std::size_t capacity = 16) {
+    std::size_t size = 8;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots_.resize(size);
+  }
+
+  /**
+   * @brief 查找 id 对应的值
+   *
+   * @param id 需要查找的 id
+   * @return value_type* 找到的值，不存在时返回 nullptr。插入或者删除以后指针失效
+   */
+  value_type *find(uint64_t id) {
+    if (id == 0) {
+      return nullptr;
+    }
+    for (auto i = index(id);; i = next(i)) {
+      if (slots_[i].id == id) {
+        return &slots_[i].value;
+      }
+      if (slots_[i].id == 0) {
+        return nullptr;
+      }
+    }
+  }
+
+  const value_type *find(uint64_t id) const {
+    return const_cast<id_table *>(this)->find(id);
+  }
+
+  /**
+   * @brief 插入或者替换 id 对应的值
+   *
+   * @param id 不能为0
+   * @param value 值
+   * @return value_type& 插入以后的值
+   */
+  value_type &insert(uint64_t id, value_type value) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+      grow();
+    }
+    auto i = index(id);
+    while (slots_[i].id != 0 && slots_[i].id != id) {
+      i = next(i);
+    }
+    if (slots_[i].id == 0) {
+      slots_[i].id = id;
+      ++size_;
+    }
+    slots_[i].value = std::move(value);
+    return slots_[i].value;
+  }
+
+  /**
+   * @brief 删除 id 对应的值
+   *
+   * @param id 需要删除的 id
+   * @return true 删除成功
+   * @return false id 不存在
+   */
+  bool erase(uint64_t id) {
+    if (id == 0) {
+      return false;
+    }
+    auto hole = index(id);
+    while (slots_[hole].id != id) {
+      if (slots_[hole].id == 0) {
+        return false;
+      }
+      hole = next(hole);
+    }
+
+    // 后面同一个探测链上的元素向前移动填补空位，保证查找不会提前遇到空位
+    for (auto i = next(hole); slots_[i].id != 0; i = next(i)) {
+      auto home = index(slots_[i].id);
+      auto distance_to_hole = (hole - home) & (slots_.size() - 1);
+      auto distance_to_i = (i - home) & (slots_.size() - 1);
+      if (distance_to_hole < distance_to_i) {
+        slots_[hole] = std::move(slots_[i]);
+        hole = i;
+      }
+    }
+    slots_[hole] = slot{};
+    --size_;
+    return true;
+  }
+
+  /**
+   * @brief 遍历所有元素，遍历过程中不能插入或者删除
+   *
+   * @param call_back 遍历回调，参数为 id 和值
+   */
+  template <typename call_back_type> void for_each(call_back_type &&call_back) {
+    for (auto &slot : slots_) {
+      if (slot.id != 0) {
+        call_back(slot.id, slot.value);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto &slot : slots_) {
+      slot = {};
+    }
+    size_ = 0;
+  }
+
+  inline std::size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+private:
+  struct slot {
+    uint64_t id{0};
+    value_type value{};
+  };
+
+  inline std::size_t index(uint64_t id) const {
+    // splitmix64 的混合函数，连续的 id 也能均匀分布
+    id ^= id >> 30;
+    id *= 0xbf58476d1ce4e5b9ULL;
+    id ^= id >> 27;
+    id *= 0x94d049bb133111ebULL;
+    id ^= id >> 31;
+    return static_cast<std::size_t>(id) & (slots_.size() - 1);
+  }
+
+  inline std::size_t next(std::size_t i) const {
+    return (i + 1) & (slots_.size() - 1);
+  }
+
+  void grow() {
+    std::vector<slot> slots(slots_.size() * 2);
+    slots.swap(slots_);
+    size_ = 0;
+    for (auto &slot : slots) {
+      if (slot.id != 0) {
+        insert(slot.id, std::move(slot.value));
+      }
+    }
+  }
+
+private:
+  std::vector<slot> slots_;
+  std::size_t size_{0};
+};
+
+} // namespace salt
@@ -0,0 +1,83 @@
+#include "salt/util/timing_wheel.h"
+
+#include <algorithm>
+
+namespace salt {
+
+timing_wheel::timing_wheel(std::chrono::milliseconds tick, uint32_t slot_count,
+                           clock::time_point now /* = clock::now() */)
+    : tick_(std::max(tick, std::chrono::milliseconds{1})), start_(now),
+      slots_(std::max(slot_count, 1u)) {}
+
+timing_wheel::timer_id timing_wheel::add(std::chrono::milliseconds delay,
+                                         std::function<void()> callback) {
+  delay = std::max(delay, std::chrono::milliseconds{0});
+  auto ticks = static_cast<uint64_t>(
+      (delay + tick_ - std::chrono::milliseconds{1}) / tick_);
+  ticks = std::max<uint64_t>(ticks, 1);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto expire_tick = current_tick_ + ticks;
+  auto &slot = slots_[expire_tick % slots_.size()];
+  auto id = next_id_++;
+  slot.push_back(timer{id, expire_tick, std::move(callback)});
+  timers_.emplace(id, std::prev(slot.end()));
+  return id;
+}
+
+bool timing_wheel::cancel(timer_id id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto pos = timers_.find(id);
+  if (pos == timers_.end()) {
+    return false;
+  }
+  slots_[pos->second->expire_tick_ % slots_.size()].erase(pos->second);
+  timers_.erase(pos);
+  return true;
+}
+
+std::size_t
+timing_wheel::advance(clock::time_point now /* = clock::now() */) {
+  std::vector<std::function<void()>> expired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (now < start_) {
+      return 0;
+    }
+    auto target_tick = static_cast<uint64_t>((now - start_) / tick_);
+    if (target_tick <= current_tick_) {
+      return 0;
+    }
+
+    // 落后超过一圈时，每个格子只需要扫描一次
+    auto steps = std::min<uint64_t>(target_tick - current_tick_, slots_.size());
+    for (auto i = 1u; i <= steps; ++i) {
+      auto &slot = slots_[(current_tick_ + i) % slots_.size()];
+      for (auto it = slot.begin(); it != slot.end();) {
+        if (it->expire_tick_ <= target_tick) {
+          expired.push_back(std::move(it->callback_));
+          timers_.erase(it->id_);
+          it = slot.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    current_tick_ = target_tick;
+  }
+
+  // 在锁外调用回调，回调中可以重新添加定时器
+  for (auto &callback : expired) {
+    if (callback) {
+      callback();
+    }
+  }
+  return expired.size();
+}
+
+std::size_t timing_wheel::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return timers_.size();
+}
+
+} // namespace salt
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace salt {
+
+/**
+ * @brief 哈希时间轮。添加、取消定时器都是 O(1)，适合给大量链接做超时检测。
+ *        时间轮本身不会计时，需要外部定期调用 advance 推进，到期的回调在 advance
+ *        中调用。线程安全
+ *
+ */
+class timing_wheel {
+public:
+  using clock = std::chrono::steady_clock;
+  using timer_id = uint64_t;
+
+  /**
+   * @brief 创建时间轮
+   *
+   * @param tick 每一格的时间，定时器的精度
+   * @param slot_count 格子数量，超过一圈的定时器会在同一个格子中等待多圈
+   * @param now 时间轮的起始时间
+   */
+  timing_wheel(std::chrono::milliseconds tick, uint32_t slot_count,
+               clock::time_point now = clock::now());
+
+  /**
+   * @brief 添加定时器
+   *
+   * @param delay 多久以后触发，向上取整到 tick，至少一个 tick
+   * @param callback 定时器到期时的回调，在 advance 中调用
+   * @return timer_id 定时器 id，可以用来取消定时器
+   */
+  timer_id add(std::chrono::milliseconds delay, std::function<void()> callback);
+
+  /**
+   * @brief 取消定时器
+   *
+   * @param id add 返回的定时器 id
+   * @return true 取消成功
+   * @return false 定时器不存在或者已经触发
+   */
+  bool cancel(timer_id id);
+
+  /**
+   * @brief 把时间轮推进到 now，并调用所有到期定时器的回调
+   *
+   * @param now 当前时间
+   * @return std::size_t 触发的定时器数量
+   */
+  std::size_t advance(clock::time_point now = clock::now());
+
+  /**
+   * @brief 获取还没有触发的定时器数量
+   *
+   * @return std::size_t 定时器数量
+   */
+  std::size_t size() const;
+
+  inline std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+  struct timer {
+    timer_id id_;
+    uint64_t expire_tick_;
+    std::function<void()> callback_;
+  };
+
+private:
+  const std::chrono::milliseconds tick_;
+  const clock::time_point start_;
+  mutable std::mutex mutex_;
+  std::vector<std::list<timer>> slots_;
+  std::unordered_map<timer_id, std::list<timer>::iterator> timers_;
+  uint64_t current_tick_{0};
+  timer_id next_id_{1};
+};
+
+} // namespace salt
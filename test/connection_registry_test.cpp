@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "salt/core/connection_registry.h"
+
+static std::shared_ptr<salt::tcp_connection>
+make_connection(asio::io_context &io_context, uint64_t id) {
+  return salt::tcp_connection::create(io_context, nullptr, nullptr, false, id);
+}
+
+TEST(connection_registry_test, add_find_remove) {
+  asio::io_context io_context;
+  salt::connection_registry registry{4};
+  auto connection = make_connection(io_context, 7);
+  registry.add(connection->get_id(), connection);
+  ASSERT_EQ(registry.size(), 1);
+  ASSERT_EQ(registry.find(7), connection);
+  ASSERT_EQ(registry.find(8), nullptr);
+  ASSERT_EQ(connection->get_handle()->id(), 7);
+
+  registry.remove(7);
+  registry.remove(7);
+  ASSERT_EQ(registry.size(), 0);
+  ASSERT_EQ(registry.find(7), nullptr);
+}
+
+TEST(connection_registry_test, weak_reference) {
+  asio::io_context io_context;
+  salt::connection_registry registry{4};
+  auto connection = make_connection(io_context, 1);
+  registry.add(1, connection);
+  connection.reset();
+  ASSERT_EQ(registry.find(1), nullptr);
+
+  auto count = 0;
+  registry.for_each([&count](const auto &) { ++count; });
+  ASSERT_EQ(count, 0);
+}
+
+TEST(connection_registry_test, concurrent_for_each) {
+  asio::io_context io_context;
+  salt::connection_registry registry{8};
+  std::vector<std::shared_ptr<salt::tcp_connection>> connections;
+  for (auto i = 1u; i <= 1000; ++i) {
+    connections.push_back(make_connection(io_context, i));
+  }
+
+  std::atomic<bool> stop{false};
+  std::thread reader{[&] {
+    while (!stop) {
+      registry.for_each([](const auto &connection) {
+        ASSERT_NE(connection->get_id(), 0);
+      });
+    }
+  }};
+  for (const auto &connection : connections) {
+    registry.add(connection->get_id(), connection);
+  }
+  for (auto i = 1u; i <= 1000; i += 2) {
+    registry.remove(i);
+  }
+  stop = true;
+  reader.join();
+
+  ASSERT_EQ(registry.size(), 500);
+  auto count = 0;
+  registry.for_each([&count](const auto &connection) {
+    ASSERT_EQ(connection->get_id() % 2, 0);
+    ++count;
+  });
+  ASSERT_EQ(count, 500);
+}
+
+TEST(connection_registry_test, modify_in_for_each) {
+  asio::io_context io_context;
+  salt::connection_registry registry{1};
+  auto first = make_connection(io_context, 1);
+  auto second = make_connection(io_context, 2);
+  registry.add(1, first);
+
+  // 遍历回调在锁外执行，可以修改链接表，修改不影响正在遍历的快照
+  auto count = 0;
+  registry.for_each([&](const auto &connection) {
+    registry.add(2, second);
+    registry.remove(1);
+    ++count;
+  });
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(registry.find(1), nullptr);
+  ASSERT_EQ(registry.find(2), second);
+
+  std::vector<uint64_t> ids;
+  registry.for_each([&ids](const auto &connection) {
+    ids.push_back(connection->get_id());
+  });
+  ASSERT_EQ(ids, std::vector<uint64_t>{2});
+}
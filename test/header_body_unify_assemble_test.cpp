@@ -387,4 +387,42 @@ TEST(salt_header_body_unify_assemble_test, empty_body_4) {
   ASSERT_TRUE(true);
 }
 
+TEST(salt_header_body_unify_assemble_test, string_view) {
+  message_header16 h;
+  h.magic_ = 12345;
+  auto s = encode_with_string(h, "string",
+                              salt::body_length_calc_mode::with_length_field);
+  s +=
+      encode_with_string(h, "", salt::body_length_calc_mode::with_length_field);
+  s += encode_with_string(h, "view",
+                          salt::body_length_calc_mode::with_length_field);
+  for (int step = 1; step < s.size() + 1; ++step) {
+    auto packet_assemble =
+        salt::header_body_unify_assemble<message_header16, &message_header16::len_>();
+    packet_assemble.body_length_calc_mode_ =
+        salt::body_length_calc_mode::with_length_field;
+    std::vector<std::string> token;
+    auto notify = std::make_unique<test_notify<message_header16>>(token);
+    packet_assemble.set_notify(std::move(notify));
+    std::string_view view{s};
+    uint32_t current_offset = 0;
+    while (current_offset < s.size()) {
+      auto result = (&packet_assemble)
+                        ->data_received(nullptr,
+                                        view.substr(current_offset, step));
+      ASSERT_EQ(result, salt::data_read_result::success);
+      if (result != salt::data_read_result::success) {
+        return;
+      }
+      current_offset += step;
+    }
+    ASSERT_EQ(token.size(), 3);
+    ASSERT_STREQ(token[0].c_str(), "string");
+    ASSERT_TRUE(token[1].empty());
+    ASSERT_STREQ(token[2].c_str(), "view");
+  }
+
+  ASSERT_TRUE(true);
+}
+
 // tyzual:以后再写拆包器我是狗（）
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "salt/util/id_table.h"
+
+TEST(id_table_test, insert_find_erase) {
+  salt::id_table<std::string> table;
+  ASSERT_TRUE(table.empty());
+  ASSERT_EQ(table.find(1), nullptr);
+  ASSERT_EQ(table.find(0), nullptr);
+
+  table.insert(1, "one");
+  table.insert(2, "two");
+  ASSERT_EQ(table.size(), 2);
+  ASSERT_EQ(*table.find(1), "one");
+  ASSERT_EQ(*table.find(2), "two");
+
+  table.insert(1, "uno");
+  ASSERT_EQ(table.size(), 2);
+  ASSERT_EQ(*table.find(1), "uno");
+
+  ASSERT_TRUE(table.erase(1));
+  ASSERT_FALSE(table.erase(1));
+  ASSERT_EQ(table.find(1), nullptr);
+  ASSERT_EQ(*table.find(2), "two");
+  ASSERT_EQ(table.size(), 1);
+}
+
+TEST(id_table_test, grow) {
+  salt::id_table<uint64_t> table{2};
+  for (auto i = 1u; i <= 10000; ++i) {
+    table.insert(i, i * 2);
+  }
+  ASSERT_EQ(table.size(), 10000);
+  for (auto i = 1u; i <= 10000; ++i) {
+    ASSERT_EQ(*table.find(i), i * 2);
+  }
+
+  uint64_t sum = 0;
+  table.for_each([&sum](uint64_t id, uint64_t value) { sum += value - id; });
+  ASSERT_EQ(sum, 10000ull * 10001 / 2);
+}
+
+TEST(id_table_test, random_operations) {
+  salt::id_table<uint64_t> table;
+  std::unordered_map<uint64_t, uint64_t> expected;
+  std::mt19937_64 engine{42};
+  for (auto i = 0; i < 200000; ++i) {
+    auto id = engine() % 2048 + 1;
+    if (engine() % 3 == 0) {
+      ASSERT_EQ(table.erase(id), expected.erase(id) == 1);
+    } else {
+      table.insert(id, i);
+      expected[id] = i;
+    }
+  }
+
+  ASSERT_EQ(table.size(), expected.size());
+  for (auto id = 1u; id <= 2048; ++id) {
+    auto pos = expected.find(id);
+    auto value = table.find(id);
+    if (pos == expected.end()) {
+      ASSERT_EQ(value, nullptr);
+    } else {
+      ASSERT_NE(value, nullptr);
+      ASSERT_EQ(*value, pos->second);
+    }
+  }
+
+  table.clear();
+  ASSERT_TRUE(table.empty());
+  ASSERT_EQ(table.find(1), nullptr);
+}
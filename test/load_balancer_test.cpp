@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <map>
+
+#include "salt/core/load_balancer.h"
+
+class fake_connection_handle : public salt::connection_handle {
+public:
+  fake_connection_handle(std::size_t pending_send_bytes,
+                         std::chrono::microseconds rtt)
+      : pending_send_bytes_(pending_send_bytes), rtt_(rtt) {}
+
+  void send(std::string,
+            std::function<void(const std::error_code &)>) override {}
+
+  std::size_t pending_send_bytes() const override {
+    return pending_send_bytes_;
+  }
+
+  std::chrono::microseconds rtt() const override { return rtt_; }
+
+private:
+  std::size_t pending_send_bytes_;
+  std::chrono::microseconds rtt_;
+};
+
+static std::shared_ptr<salt::connection_handle>
+make_handle(std::size_t pending_send_bytes, int64_t rtt_us = 0) {
+  return std::make_shared<fake_connection_handle>(
+      pending_send_bytes, std::chrono::microseconds{rtt_us});
+}
+
+TEST(load_balancer_test, empty_candidates) {
+  for (auto policy : {salt::load_balance_policy::round_robin,
+                      salt::load_balance_policy::power_of_two_choices,
+                      salt::load_balance_policy::least_latency}) {
+    auto balancer = salt::load_balancer::create(policy);
+    ASSERT_EQ(balancer->select({}), nullptr);
+  }
+}
+
+TEST(load_balancer_test, round_robin) {
+  auto balancer =
+      salt::load_balancer::create(salt::load_balance_policy::round_robin);
+  std::vector<std::shared_ptr<salt::connection_handle>> candidates{
+      make_handle(0), make_handle(0), make_handle(0)};
+  std::map<salt::connection_handle *, int> count;
+  for (auto i = 0; i < 300; ++i) {
+    ++count[balancer->select(candidates).get()];
+  }
+  ASSERT_EQ(count.size(), 3);
+  for (const auto &item : count) {
+    ASSERT_EQ(item.second, 100);
+  }
+}
+
+TEST(load_balancer_test, power_of_two_choices) {
+  auto balancer = salt::load_balancer::create(
+      salt::load_balance_policy::power_of_two_choices);
+  auto busy = make_handle(1024 * 1024);
+  std::vector<std::shared_ptr<salt::connection_handle>> candidates{
+      busy, make_handle(0)};
+  for (auto i = 0; i < 100; ++i) {
+    ASSERT_NE(balancer->select(candidates), busy);
+  }
+
+  // 两个候选不重复，发送队列最长的链接总是输给另一个候选
+  candidates.push_back(make_handle(10));
+  std::map<salt::connection_handle *, int> count;
+  for (auto i = 0; i < 300; ++i) {
+    ++count[balancer->select(candidates).get()];
+  }
+  ASSERT_EQ(count.count(busy.get()), 0);
+  ASSERT_EQ(count.size(), 2);
+}
+
+TEST(load_balancer_test, least_latency) {
+  auto balancer =
+      salt::load_balancer::create(salt::load_balance_policy::least_latency);
+  auto fast = make_handle(0, 100);
+  auto slow = make_handle(0, 500);
+  std::vector<std::shared_ptr<salt::connection_handle>> candidates{
+      slow, fast, make_handle(0, 200)};
+  std::map<salt::connection_handle *, int> count;
+  for (auto i = 0; i < 300; ++i) {
+    ++count[balancer->select(candidates).get()];
+  }
+  // RTT 最大的链接总是输给另一个候选，流量不会全部集中到 RTT 最小的链接
+  ASSERT_EQ(count.count(slow.get()), 0);
+  ASSERT_EQ(count.size(), 2);
+  ASSERT_GT(count[fast.get()], 150);
+  ASSERT_LT(count[fast.get()], 300);
+}
+
+TEST(load_balancer_test, least_latency_unmeasured) {
+  auto balancer =
+      salt::load_balancer::create(salt::load_balance_policy::least_latency);
+  auto unmeasured = make_handle(0);
+  std::vector<std::shared_ptr<salt::connection_handle>> candidates{
+      make_handle(0, 100), unmeasured};
+  // 还没有测量 RTT 的链接优先被选中
+  for (auto i = 0; i < 10; ++i) {
+    ASSERT_EQ(balancer->select(candidates), unmeasured);
+  }
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include "salt/core/async_send.h"
+#include "salt/packet_assemble/packet_channel.h"
+
+struct channel_header {
+  uint32_t len;
+};
+
+class fake_connection : public salt::connection_handle {
+public:
+  void send(std::string data,
+            std::function<void(const std::error_code &)> call_back) override {
+    sent_.push_back(std::move(data));
+    call_back_ = std::move(call_back);
+  }
+
+  std::vector<std::string> sent_;
+  std::function<void(const std::error_code &)> call_back_;
+};
+
+static salt::packet make_packet(const std::string &body) {
+  return salt::packet{nullptr, std::string(sizeof(channel_header), '\0'),
+                      body};
+}
+
+TEST(packet_channel_test, queued_packet) {
+  asio::io_context io_context;
+  auto channel = salt::packet_channel<channel_header>::create();
+  ASSERT_TRUE(channel->push(make_packet("hello")));
+  ASSERT_EQ(channel->pending_packets(), 1);
+
+  std::string body;
+  channel->async_next_packet(asio::bind_executor(
+      io_context, [&](const std::error_code &err_code, salt::packet p) {
+        ASSERT_FALSE(err_code);
+        body = std::move(p.body);
+      }));
+  ASSERT_EQ(channel->pending_packets(), 0);
+  io_context.run();
+  ASSERT_EQ(body, "hello");
+}
+
+TEST(packet_channel_test, waiting_receiver) {
+  asio::io_context io_context;
+  auto channel = salt::packet_channel<channel_header>::create();
+
+  std::vector<std::string> bodies;
+  channel->async_next_packet(asio::bind_executor(
+      io_context, [&](const std::error_code &err_code, salt::packet p) {
+        ASSERT_FALSE(err_code);
+        bodies.push_back(std::move(p.body));
+      }));
+  channel->async_next_packet(asio::bind_executor(
+      io_context, [&](const std::error_code &err_code, salt::packet p) {
+        ASSERT_EQ(err_code, asio::error::in_progress);
+      }));
+  ASSERT_TRUE(channel->push(make_packet("a")));
+  ASSERT_TRUE(channel->push(make_packet("b")));
+  io_context.run();
+  ASSERT_EQ(bodies, std::vector<std::string>{"a"});
+  ASSERT_EQ(channel->pending_packets(), 1);
+}
+
+TEST(packet_channel_test, close) {
+  asio::io_context io_context;
+  auto channel = salt::packet_channel<channel_header>::create();
+  ASSERT_TRUE(channel->push(make_packet("last")));
+  channel->close();
+  ASSERT_FALSE(channel->push(make_packet("dropped")));
+
+  std::vector<std::string> bodies;
+  std::error_code last_error;
+  auto receive = [&](const std::error_code &err_code, salt::packet p) {
+    if (err_code) {
+      last_error = err_code;
+    } else {
+      bodies.push_back(std::move(p.body));
+    }
+  };
+  channel->async_next_packet(asio::bind_executor(io_context, receive));
+  io_context.run();
+  io_context.restart();
+  channel->async_next_packet(asio::bind_executor(io_context, receive));
+  io_context.run();
+  ASSERT_EQ(bodies, std::vector<std::string>{"last"});
+  ASSERT_EQ(last_error, asio::error::eof);
+}
+
+TEST(packet_channel_test, max_pending_packets) {
+  auto channel = salt::packet_channel<channel_header>::create(1);
+  auto notify = channel->make_notify();
+  ASSERT_EQ(notify->packet_reserved(nullptr, "", "a"),
+            salt::data_read_result::success);
+  ASSERT_EQ(notify->packet_reserved(nullptr, "", "b"),
+            salt::data_read_result::disconnect);
+  ASSERT_EQ(channel->pending_packets(), 1);
+}
+
+TEST(packet_channel_test, full_channel_disconnect) {
+  auto channel = salt::packet_channel<channel_header>::create(1);
+  salt::header_body_assemble<channel_header, &channel_header::len> assemble;
+  assemble.set_notify(channel->make_notify());
+
+  std::string data;
+  for (auto body : {"a", "b", "c"}) {
+    channel_header header{salt::byte_order::to_network(uint32_t{1})};
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(body);
+  }
+  ASSERT_EQ(assemble.data_received(nullptr, std::string_view{data}),
+            salt::data_read_result::disconnect);
+  ASSERT_EQ(channel->pending_packets(), 1);
+}
+
+TEST(packet_channel_test, async_send) {
+  asio::io_context io_context;
+  auto connection = std::make_shared<fake_connection>();
+  std::error_code result = asio::error::would_block;
+  salt::async_send(connection, "data",
+                   asio::bind_executor(io_context,
+                                       [&](const std::error_code &err_code) {
+                                         result = err_code;
+                                       }));
+  ASSERT_EQ(connection->sent_, std::vector<std::string>{"data"});
+  connection->call_back_(std::error_code{});
+  ASSERT_EQ(result, asio::error::would_block);
+  io_context.run();
+  ASSERT_FALSE(result);
+}
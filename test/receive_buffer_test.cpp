@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include "salt/core/receive_buffer.h"
+
+TEST(receive_buffer_test, fixed) {
+  salt::receive_buffer_policy policy;
+  policy.mode = salt::receive_buffer_mode::fixed;
+  policy.initial_size = 4096;
+  salt::receive_buffer_sizer sizer{policy};
+  ASSERT_EQ(sizer.size(), 4096);
+  sizer.record(4096);
+  ASSERT_EQ(sizer.size(), 4096);
+  sizer.record(1);
+  ASSERT_EQ(sizer.size(), 4096);
+}
+
+TEST(receive_buffer_test, adaptive_grow) {
+  salt::receive_buffer_policy policy;
+  policy.mode = salt::receive_buffer_mode::adaptive;
+  policy.initial_size = 1024;
+  policy.min_size = 512;
+  policy.max_size = 8192;
+  salt::receive_buffer_sizer sizer{policy};
+  ASSERT_EQ(sizer.size(), 1024);
+  sizer.record(1024);
+  ASSERT_EQ(sizer.size(), 2048);
+  sizer.record(2048);
+  ASSERT_EQ(sizer.size(), 4096);
+  sizer.record(4096);
+  ASSERT_EQ(sizer.size(), 8192);
+  sizer.record(8192);
+  ASSERT_EQ(sizer.size(), 8192);
+}
+
+TEST(receive_buffer_test, adaptive_shrink) {
+  salt::receive_buffer_policy policy;
+  policy.mode = salt::receive_buffer_mode::adaptive;
+  policy.initial_size = 4096;
+  policy.min_size = 1024;
+  policy.max_size = 8192;
+  policy.shrink_after_reads = 2;
+  salt::receive_buffer_sizer sizer{policy};
+  sizer.record(100);
+  ASSERT_EQ(sizer.size(), 4096);
+  sizer.record(100);
+  ASSERT_EQ(sizer.size(), 2048);
+
+  // 中间有一次较大的读取，重新计数
+  sizer.record(100);
+  sizer.record(2000);
+  sizer.record(100);
+  ASSERT_EQ(sizer.size(), 2048);
+  sizer.record(100);
+  ASSERT_EQ(sizer.size(), 1024);
+
+  sizer.record(1);
+  sizer.record(1);
+  ASSERT_EQ(sizer.size(), 1024);
+}
+
+TEST(receive_buffer_test, adaptive_bounds) {
+  salt::receive_buffer_policy policy;
+  policy.mode = salt::receive_buffer_mode::adaptive;
+  policy.initial_size = 100;
+  policy.min_size = 512;
+  policy.max_size = 256;
+  salt::receive_buffer_sizer sizer{policy};
+  ASSERT_EQ(sizer.size(), 512);
+  sizer.record(512);
+  ASSERT_EQ(sizer.size(), 512);
+}
@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+
+#include "salt/core/reconnect_backoff.h"
+
+using namespace std::chrono_literals;
+
+TEST(reconnect_backoff_test, ceiling) {
+  salt::reconnect_backoff backoff;
+  ASSERT_FALSE(backoff.enabled());
+
+  backoff.initial_delay = 100ms;
+  backoff.max_delay = 1000ms;
+  ASSERT_TRUE(backoff.enabled());
+  ASSERT_EQ(backoff.ceiling(1), 100ms);
+  ASSERT_EQ(backoff.ceiling(2), 200ms);
+  ASSERT_EQ(backoff.ceiling(4), 800ms);
+  ASSERT_EQ(backoff.ceiling(5), 1000ms);
+  ASSERT_EQ(backoff.ceiling(1000000), 1000ms);
+
+  backoff.multiplier = 0.5;
+  ASSERT_EQ(backoff.ceiling(3), 100ms);
+}
+
+TEST(reconnect_backoff_test, full_jitter) {
+  salt::reconnect_backoff backoff;
+  backoff.initial_delay = 100ms;
+  backoff.max_delay = 1000ms;
+  std::minstd_rand engine{42};
+
+  auto min = 1000ms;
+  auto max = 0ms;
+  for (auto i = 0; i < 1000; ++i) {
+    auto delay = backoff.delay(3, engine);
+    ASSERT_GE(delay, 0ms);
+    ASSERT_LE(delay, 400ms);
+    min = std::min(min, delay);
+    max = std::max(max, delay);
+  }
+  // 等待时间分散在整个区间内
+  ASSERT_LT(min, 40ms);
+  ASSERT_GT(max, 360ms);
+
+  backoff.full_jitter = false;
+  ASSERT_EQ(backoff.delay(3, engine), 400ms);
+}
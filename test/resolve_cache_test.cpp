@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include "salt/core/resolve_cache.h"
+
+using namespace std::chrono_literals;
+
+TEST(resolve_cache_test, numeric_address) {
+  asio::io_context io_context;
+  salt::resolve_cache cache(io_context);
+
+  std::error_code result_code = asio::error::would_block;
+  salt::resolve_cache::endpoints result;
+  cache.async_resolve(
+      "::1", 8080,
+      [&](const std::error_code &err_code,
+          salt::resolve_cache::endpoints endpoints) {
+        result_code = err_code;
+        result = std::move(endpoints);
+      });
+
+  // 数字形式的地址不需要运行 io_context
+  ASSERT_FALSE(result_code);
+  ASSERT_EQ(result.size(), 1u);
+  ASSERT_EQ(result.front().address(), asio::ip::make_address("::1"));
+  ASSERT_EQ(result.front().port(), 8080);
+  ASSERT_EQ(cache.size(), 0u);
+}
+
+TEST(resolve_cache_test, cache_hit) {
+  asio::io_context io_context;
+  salt::resolve_cache cache(io_context);
+
+  auto call_cnt = 0;
+  auto call_back = [&](const std::error_code &err_code,
+                       salt::resolve_cache::endpoints endpoints) {
+    ASSERT_FALSE(err_code);
+    ASSERT_FALSE(endpoints.empty());
+    ASSERT_EQ(endpoints.front().port(), 80);
+    ++call_cnt;
+  };
+
+  // 同一个域名同时只解析一次
+  cache.async_resolve("localhost", 80, call_back);
+  cache.async_resolve("localhost", 80, call_back);
+  ASSERT_EQ(call_cnt, 0);
+  io_context.run();
+  ASSERT_EQ(call_cnt, 2);
+  ASSERT_EQ(cache.size(), 1u);
+
+  // 命中缓存时直接调用回调
+  cache.async_resolve("localhost", 80, call_back);
+  ASSERT_EQ(call_cnt, 3);
+
+  cache.clear();
+  ASSERT_EQ(cache.size(), 0u);
+}
+
+TEST(resolve_cache_test, negative_cache) {
+  asio::io_context io_context;
+  salt::resolve_cache cache(io_context);
+
+  std::error_code first_code;
+  cache.async_resolve("salt-test.invalid", 80,
+                      [&](const std::error_code &err_code,
+                          salt::resolve_cache::endpoints endpoints) {
+                        first_code = err_code;
+                      });
+  io_context.run();
+  ASSERT_TRUE(first_code);
+
+  std::error_code second_code;
+  cache.async_resolve("salt-test.invalid", 80,
+                      [&](const std::error_code &err_code,
+                          salt::resolve_cache::endpoints endpoints) {
+                        second_code = err_code;
+                      });
+  ASSERT_EQ(second_code, first_code);
+
+  // 不缓存失败的结果
+  salt::resolve_cache_policy policy;
+  policy.negative_ttl = 0ms;
+  cache.set_policy(policy);
+  cache.clear();
+  cache.async_resolve("salt-test.invalid", 80,
+                      [](const std::error_code &,
+                         salt::resolve_cache::endpoints) {});
+  io_context.restart();
+  io_context.run();
+  ASSERT_EQ(cache.size(), 0u);
+}
@@ -0,0 +1,230 @@
+#include "gtest/gtest.h"
+
+#include <future>
+
+#include "salt/packet_assemble/rpc_session.h"
+
+struct rpc_header {
+  uint32_t len;
+  uint32_t seq;
+};
+
+class fake_connection : public salt::connection_handle {
+public:
+  void send(std::string data,
+            std::function<void(const std::error_code &)> call_back) override {
+    sent_.push_back(std::move(data));
+    salt::call(call_back, send_error_);
+  }
+
+  std::vector<std::string> sent_;
+  std::error_code send_error_;
+};
+
+using session_type = salt::rpc_session<rpc_header, &rpc_header::seq>;
+
+static rpc_header make_header(const std::string &body) {
+  return rpc_header{salt::byte_order::to_network(uint32_t(body.size())), 0};
+}
+
+static uint32_t sent_seq(const std::string &data) {
+  return salt::byte_order::to_host(
+      reinterpret_cast<const rpc_header *>(data.data())->seq);
+}
+
+// 把请求原样作为 connection 上收到的响应交给拆包器的 notify
+static void echo(salt::header_body_assemble_notify<rpc_header> &notify,
+                 const std::shared_ptr<salt::connection_handle> &connection,
+                 const std::string &data) {
+  notify.packet_reserved(connection, data.substr(0, sizeof(rpc_header)),
+                         data.substr(sizeof(rpc_header)));
+}
+
+TEST(rpc_session_test, out_of_order_responses) {
+  asio::io_context io_context;
+  auto session =
+      session_type::create(salt::io_timing_wheel::create(io_context));
+  auto notify = session->make_notify();
+  auto connection = std::make_shared<fake_connection>();
+
+  std::vector<std::string> responses;
+  for (auto body : {"a", "b", "c"}) {
+    session->call(connection, make_header(body), body,
+                  std::chrono::milliseconds{0},
+                  [&](const std::error_code &err_code, salt::packet p) {
+                    ASSERT_FALSE(err_code);
+                    responses.push_back(std::move(p.body));
+                  });
+  }
+  ASSERT_EQ(connection->sent_.size(), 3);
+  ASSERT_EQ(session->pending_requests(), 3);
+  ASSERT_NE(sent_seq(connection->sent_[0]), sent_seq(connection->sent_[1]));
+
+  echo(*notify, connection, connection->sent_[2]);
+  echo(*notify, connection, connection->sent_[0]);
+  echo(*notify, connection, connection->sent_[1]);
+  // 重复的响应没有对应的请求，不会再次回调
+  echo(*notify, connection, connection->sent_[1]);
+  ASSERT_EQ(responses, (std::vector<std::string>{"c", "a", "b"}));
+  ASSERT_EQ(session->pending_requests(), 0);
+}
+
+TEST(rpc_session_test, unmatched_packet_forwarded) {
+  class push_notify : public salt::header_body_assemble_notify<rpc_header> {
+  public:
+    explicit push_notify(int &count) : count_(count) {}
+    salt::data_read_result
+    packet_reserved(std::shared_ptr<salt::connection_handle>, std::string,
+                    std::string) override {
+      ++count_;
+      return salt::data_read_result::success;
+    }
+
+  private:
+    int &count_;
+  };
+
+  asio::io_context io_context;
+  auto session =
+      session_type::create(salt::io_timing_wheel::create(io_context));
+  auto count = 0;
+  auto notify = session->make_notify(std::make_unique<push_notify>(count));
+  rpc_header header{0, salt::byte_order::to_network(uint32_t(100))};
+  notify->packet_reserved(
+      nullptr, std::string(reinterpret_cast<char *>(&header), sizeof(header)),
+      "");
+  ASSERT_EQ(count, 1);
+}
+
+TEST(rpc_session_test, timeout_and_send_error) {
+  asio::io_context io_context;
+  auto timing_wheel =
+      salt::io_timing_wheel::create(io_context, std::chrono::milliseconds{5});
+  timing_wheel->start();
+  auto session = session_type::create(timing_wheel);
+  auto connection = std::make_shared<fake_connection>();
+
+  std::error_code timeout_error;
+  session->call(connection, make_header(""), "", std::chrono::milliseconds{20},
+                [&](const std::error_code &err_code, salt::packet) {
+                  timeout_error = err_code;
+                  timing_wheel->stop();
+                });
+  io_context.run_for(std::chrono::seconds{2});
+  ASSERT_EQ(timeout_error,
+            salt::make_error_code(salt::error_code::request_timeout));
+
+  connection->send_error_ = asio::error::make_error_code(asio::error::eof);
+  std::error_code send_error;
+  session->call(connection, make_header(""), "", std::chrono::milliseconds{0},
+                [&](const std::error_code &err_code, salt::packet) {
+                  send_error = err_code;
+                });
+  ASSERT_EQ(send_error, asio::error::eof);
+  ASSERT_EQ(session->pending_requests(), 0);
+}
+
+TEST(rpc_session_test, future_and_cancel) {
+  asio::io_context io_context;
+  auto session =
+      session_type::create(salt::io_timing_wheel::create(io_context));
+  auto notify = session->make_notify();
+  auto connection = std::make_shared<fake_connection>();
+
+  auto response =
+      session->async_call(connection, make_header("ping"), "ping",
+                          std::chrono::milliseconds{0}, asio::use_future);
+  echo(*notify, connection, connection->sent_.back());
+  ASSERT_EQ(response.get().body, "ping");
+
+  auto cancelled =
+      session->async_call(connection, make_header("x"), "x",
+                          std::chrono::milliseconds{0}, asio::use_future);
+  session->cancel_all();
+  ASSERT_THROW(cancelled.get(), std::system_error);
+}
+
+TEST(rpc_session_test, cancel_connection) {
+  asio::io_context io_context;
+  auto session =
+      session_type::create(salt::io_timing_wheel::create(io_context));
+  auto notify = session->make_notify();
+  auto broken = std::make_shared<fake_connection>();
+  auto healthy = std::make_shared<fake_connection>();
+
+  std::vector<std::error_code> results;
+  auto call_back = [&results](const std::error_code &err_code, salt::packet) {
+    results.push_back(err_code);
+  };
+  session->call(broken, make_header("a"), "a", std::chrono::milliseconds{0},
+                call_back);
+  session->call(healthy, make_header("b"), "b", std::chrono::milliseconds{0},
+                call_back);
+  session->call(broken, make_header("c"), "c", std::chrono::milliseconds{0},
+                call_back);
+  ASSERT_EQ(session->pending_requests(), 3);
+
+  // 只完成断开的链接上的请求
+  session->cancel(broken, asio::error::make_error_code(asio::error::eof));
+  ASSERT_EQ(results, (std::vector<std::error_code>{
+                         asio::error::make_error_code(asio::error::eof),
+                         asio::error::make_error_code(asio::error::eof)}));
+  ASSERT_EQ(session->pending_requests(), 1);
+
+  echo(*notify, healthy, healthy->sent_.back());
+  ASSERT_EQ(results.size(), 3u);
+  ASSERT_FALSE(results.back());
+  ASSERT_EQ(session->pending_requests(), 0);
+}
+
+TEST(rpc_session_test, response_on_other_connection) {
+  asio::io_context io_context;
+  auto session =
+      session_type::create(salt::io_timing_wheel::create(io_context));
+  auto notify = session->make_notify();
+  auto first = std::make_shared<fake_connection>();
+  auto second = std::make_shared<fake_connection>();
+
+  std::vector<std::error_code> results;
+  session->call(first, make_header("a"), "a", std::chrono::milliseconds{0},
+                [&results](const std::error_code &err_code, salt::packet) {
+                  results.push_back(err_code);
+                });
+
+  // 另一个链接上收到相同 id 的包不能完成请求
+  echo(*notify, second, first->sent_.back());
+  ASSERT_TRUE(results.empty());
+  ASSERT_EQ(session->pending_requests(), 1);
+
+  echo(*notify, first, first->sent_.back());
+  ASSERT_EQ(results.size(), 1u);
+  ASSERT_FALSE(results.back());
+  ASSERT_EQ(session->pending_requests(), 0);
+}
+
+struct narrow_header {
+  uint32_t len;
+  uint8_t seq;
+};
+
+TEST(rpc_session_test, too_many_requests) {
+  asio::io_context io_context;
+  auto session = salt::rpc_session<narrow_header, &narrow_header::seq>::create(
+      salt::io_timing_wheel::create(io_context));
+  auto connection = std::make_shared<fake_connection>();
+
+  // uint8_t 的 id 除0以外只有255个，全部使用以后新的请求直接失败
+  std::vector<std::error_code> results;
+  for (auto i = 0; i < 256; ++i) {
+    narrow_header header{salt::byte_order::to_network(uint32_t{1}), 0};
+    session->call(connection, header, "x", std::chrono::milliseconds{0},
+                  [&results](const std::error_code &err_code, salt::packet) {
+                    results.push_back(err_code);
+                  });
+  }
+  ASSERT_EQ(session->pending_requests(), 255u);
+  ASSERT_EQ(connection->sent_.size(), 255u);
+  ASSERT_EQ(results, std::vector<std::error_code>{salt::make_error_code(
+                         salt::error_code::too_many_requests)});
+  session->cancel_all();
+}
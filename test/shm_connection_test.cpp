@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "asio.hpp"
+
+#include "salt/core/error.h"
+#include "salt/core/shm_connection.h"
+#include "salt/core/shm_ring.h"
+
+TEST(shm_connection_test, ring_wrap_around) {
+  constexpr std::size_t capacity = 16;
+  alignas(64) char memory[salt::shm_ring::region_size(capacity)];
+  salt::shm_ring::init(memory, capacity);
+  salt::shm_ring ring(memory);
+  ASSERT_EQ(ring.capacity(), capacity);
+  ASSERT_EQ(ring.readable(), 0u);
+  ASSERT_EQ(ring.writable(), capacity);
+
+  ASSERT_EQ(ring.write_some("0123456789"), 10u);
+  ASSERT_EQ(ring.peek(), "0123456789");
+  ring.consume(8);
+
+  // 写满以后只写入剩余空间
+  ASSERT_EQ(ring.write_some("abcdefghijklmnopq"), 14u);
+  ASSERT_EQ(ring.writable(), 0u);
+  ASSERT_EQ(ring.write_some("x"), 0u);
+
+  // 回绕的数据分两次读取
+  ASSERT_EQ(ring.peek(), "89abcdef");
+  ring.consume(8);
+  ASSERT_EQ(ring.peek(), "ghijklmn");
+  ring.consume(8);
+  ASSERT_EQ(ring.readable(), 0u);
+}
+
+class collect_packet_assemble : public salt::base_packet_assemble {
+public:
+  using salt::base_packet_assemble::data_received;
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> connection,
+                std::string s) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_.append(s);
+    cv_.notify_all();
+    return salt::data_read_result::success;
+  }
+
+  bool wait_for(std::size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(5),
+                        [this, size] { return data_.size() >= size; });
+  }
+
+  std::string data() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return data_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::string data_;
+};
+
+TEST(shm_connection_test, send_and_receive) {
+  auto name = "/salt_shm_test_" + std::to_string(::getpid());
+  auto server_assemble = new collect_packet_assemble;
+  auto client_assemble = new collect_packet_assemble;
+  std::error_code err_code;
+  auto server =
+      salt::shm_connection::create(name, 4096, server_assemble, err_code);
+  ASSERT_FALSE(err_code);
+  ASSERT_TRUE(server);
+  auto client = salt::shm_connection::open(name, client_assemble, err_code);
+  ASSERT_FALSE(err_code);
+  ASSERT_TRUE(client);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::error_code disconnect_code;
+  server->start(nullptr);
+  client->start([&](const std::error_code &error_code) {
+    std::lock_guard<std::mutex> lock(mutex);
+    disconnect_code = error_code;
+    cv.notify_all();
+  });
+
+  // 超过环形缓冲区大小的数据需要排队，由读取线程分多次写入
+  std::string expected;
+  std::size_t sent_cnt{0};
+  for (auto i = 0; i < 1000; ++i) {
+    auto data = std::to_string(i) + std::string(i % 64, 'x');
+    expected += data;
+    server->get_handle()->send(data, [&](const std::error_code &error_code) {
+      ASSERT_FALSE(error_code);
+      std::lock_guard<std::mutex> lock(mutex);
+      ++sent_cnt;
+    });
+  }
+  ASSERT_TRUE(client_assemble->wait_for(expected.size()));
+  ASSERT_EQ(client_assemble->data(), expected);
+
+  client->send("pong", nullptr);
+  ASSERT_TRUE(server_assemble->wait_for(4));
+  ASSERT_EQ(server_assemble->data(), "pong");
+
+  // 一方关闭以后另一方收到 eof
+  server->disconnect();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5),
+                            [&] { return !!disconnect_code; }));
+    ASSERT_EQ(sent_cnt, 1000u);
+  }
+  ASSERT_EQ(disconnect_code, asio::error::eof);
+
+  std::error_code send_code;
+  client->send("closed", [&send_code](const std::error_code &error_code) {
+    send_code = error_code;
+  });
+  ASSERT_EQ(send_code, salt::make_error_code(salt::error_code::not_connected));
+  client->disconnect();
+}
+
+TEST(shm_connection_test, wake_reader_for_queued_data) {
+  auto name = "/salt_shm_wake_test_" + std::to_string(::getpid());
+  auto client_assemble = new collect_packet_assemble;
+  std::error_code err_code;
+  auto server = salt::shm_connection::create(
+      name, 4096, new collect_packet_assemble, err_code);
+  ASSERT_TRUE(server);
+  auto client = salt::shm_connection::open(name, client_assemble, err_code);
+  ASSERT_TRUE(client);
+
+  // 不空转，让两边的读取线程都进入 futex 等待
+  server->set_spin_count(0);
+  client->set_spin_count(0);
+  server->start(nullptr);
+  client->start(nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // 超过环形缓冲区大小的数据只能放入发送队列，需要唤醒发送方的读取线程写入
+  std::string data(64 * 1024, 'x');
+  auto begin = std::chrono::steady_clock::now();
+  server->send(data, nullptr);
+  ASSERT_TRUE(client_assemble->wait_for(data.size()));
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  ASSERT_LT(elapsed, std::chrono::milliseconds(50));
+
+  server->disconnect();
+  client->disconnect();
+}
+
+TEST(shm_connection_test, disconnect_abort_queued_sends) {
+  auto name = "/salt_shm_abort_test_" + std::to_string(::getpid());
+  std::error_code err_code;
+  auto server = salt::shm_connection::create(
+      name, 4096, new collect_packet_assemble, err_code);
+  ASSERT_TRUE(server);
+  auto client = salt::shm_connection::open(name, new collect_packet_assemble,
+                                           err_code);
+  ASSERT_TRUE(client);
+
+  // 没有启动读取线程，超过环形缓冲区大小的数据一直留在发送队列中
+  std::vector<std::error_code> results;
+  for (auto i = 0; i < 3; ++i) {
+    server->send(std::string(8192, 'x'),
+                 [&results](const std::error_code &error_code) {
+                   results.push_back(error_code);
+                 });
+  }
+  ASSERT_TRUE(results.empty());
+  server->disconnect();
+  ASSERT_EQ(results, std::vector<std::error_code>(
+                         3, asio::error::make_error_code(
+                                asio::error::operation_aborted)));
+  ASSERT_EQ(server->pending_send_bytes(), 0u);
+  client->disconnect();
+}
@@ -0,0 +1,32 @@
+#include "gtest/gtest.h"
+
+#include "salt/core/stream_endpoint.h"
+
+TEST(stream_endpoint_test, ip_endpoint) {
+  salt::stream_endpoint v4 = asio::ip::tcp::endpoint(
+      asio::ip::make_address("127.0.0.1"), 2003);
+  ASSERT_FALSE(salt::is_local_endpoint(v4));
+  ASSERT_EQ(salt::endpoint_address(v4), "127.0.0.1");
+  ASSERT_EQ(salt::endpoint_port(v4), 2003);
+
+  salt::stream_endpoint v6 =
+      asio::ip::tcp::endpoint(asio::ip::make_address("::1"), 8080);
+  ASSERT_FALSE(salt::is_local_endpoint(v6));
+  ASSERT_EQ(salt::endpoint_address(v6), "::1");
+  ASSERT_EQ(salt::endpoint_port(v6), 8080);
+}
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+TEST(stream_endpoint_test, local_endpoint) {
+  std::error_code err_code;
+  auto endpoint = salt::make_local_endpoint("/tmp/salt_test.sock", err_code);
+  ASSERT_FALSE(err_code);
+  ASSERT_TRUE(salt::is_local_endpoint(endpoint));
+  ASSERT_EQ(salt::endpoint_address(endpoint), "/tmp/salt_test.sock");
+  ASSERT_EQ(salt::endpoint_port(endpoint), 0);
+
+  // 超过 sun_path 的长度
+  salt::make_local_endpoint(std::string(4096, 'x'), err_code);
+  ASSERT_TRUE(err_code);
+}
+#endif
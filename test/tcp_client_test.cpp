@@ -0,0 +1,304 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asio.hpp"
+
+#include "salt/core/error.h"
+#include "salt/core/tcp_client.h"
+
+class discard_packet_assemble : public salt::base_packet_assemble {
+public:
+  using salt::base_packet_assemble::data_received;
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> connection,
+                std::string s) override {
+    return salt::data_read_result::success;
+  }
+};
+
+class connected_notify : public salt::tcp_client_notify {
+public:
+  explicit connected_notify(std::atomic<int> &connected_cnt)
+      : connected_cnt_(connected_cnt) {}
+
+  void connection_connected(const std::string &remote_addr,
+                            uint16_t remote_port) override {
+    ++connected_cnt_;
+  }
+
+  void connection_disconnected(const std::error_code &error_code,
+                               const std::string &remote_addr,
+                               uint16_t remote_port) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    disconnect_code_ = error_code;
+  }
+
+  void connection_dropped(const std::string &remote_addr,
+                          uint16_t remote_port) override {
+    ++dropped_cnt_;
+  }
+
+  std::error_code disconnect_code() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return disconnect_code_;
+  }
+
+  std::atomic<int> dropped_cnt_{0};
+
+private:
+  std::atomic<int> &connected_cnt_;
+  std::mutex mutex_;
+  std::error_code disconnect_code_;
+};
+
+/**
+ * @brief 接受队列已满的监听 socket，新的 SYN 会被丢弃，connect 一直不会完成
+ *
+ */
+class blackhole_listener {
+public:
+  explicit blackhole_listener(asio::io_context &io_context)
+      : acceptor_(io_context) {
+    asio::ip::tcp::endpoint endpoint(asio::ip::make_address("127.0.0.2"), 0);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    acceptor_.listen(0);
+    for (auto i = 0; i < 4; ++i) {
+      sockets_.emplace_back(io_context);
+      sockets_.back().async_connect(acceptor_.local_endpoint(),
+                                    [](const std::error_code &) {});
+    }
+  }
+
+  asio::ip::tcp::endpoint endpoint() const {
+    return acceptor_.local_endpoint();
+  }
+
+private:
+  asio::ip::tcp::acceptor acceptor_;
+  std::vector<asio::ip::tcp::socket> sockets_;
+};
+
+/**
+ * @brief 让 host 解析为 addresses，不经过系统解析接口
+ *
+ */
+static void seed_resolve_cache(salt::tcp_client &client,
+                               const std::string &host,
+                               const std::vector<std::string> &addresses) {
+  auto &cached = client.resolve_cache_.entries_[host];
+  for (const auto &address : addresses) {
+    cached.addresses.push_back(asio::ip::make_address(address));
+  }
+  cached.resolved = true;
+  cached.expire = std::chrono::steady_clock::now() + std::chrono::hours(1);
+}
+
+static bool wait_until(const std::function<bool()> &predicate) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(tcp_client_test, graceful_stop_flush_and_fin) {
+  asio::io_context io_context;
+  asio::ip::tcp::acceptor acceptor(
+      io_context,
+      asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+  std::atomic<int> connected_cnt{0};
+  salt::tcp_client client;
+  client.set_transfer_thread_count(1)
+      .set_assemble_creator([] { return new discard_packet_assemble; })
+      .set_notify(std::make_unique<connected_notify>(connected_cnt));
+  auto connection_id =
+      client.connect("127.0.0.1", acceptor.local_endpoint().port());
+  ASSERT_NE(connection_id, 0u);
+
+  asio::ip::tcp::socket socket(io_context);
+  acceptor.accept(socket);
+  ASSERT_TRUE(wait_until([&connected_cnt] { return connected_cnt == 1; }));
+
+  // 服务器还没有读取，大部分数据留在客户端的发送队列中
+  std::string payload(8 * 1024 * 1024, 'x');
+  std::atomic<int> sent_cnt{0};
+  client.send(connection_id, payload,
+              [&sent_cnt](const std::error_code &error_code) {
+                if (!error_code) {
+                  ++sent_cnt;
+                }
+              });
+  auto stopped = std::async(std::launch::async, [&client] {
+    return client.graceful_stop(std::chrono::seconds(5));
+  });
+
+  std::vector<char> buffer(64 * 1024);
+  std::size_t received{0};
+  std::error_code err_code;
+  while (!err_code) {
+    received += socket.read_some(asio::buffer(buffer), err_code);
+  }
+  ASSERT_EQ(err_code, asio::error::eof);
+  ASSERT_EQ(received, payload.size());
+
+  auto result = stopped.get();
+  ASSERT_EQ(sent_cnt, 1);
+  ASSERT_EQ(result.connections.size(), 1u);
+  ASSERT_EQ(result.timeout_count, 0u);
+  ASSERT_EQ(result.dropped_bytes, 0u);
+}
+
+TEST(tcp_client_test, interleave_address_family) {
+  auto make_endpoint = [](const char *address) {
+    return asio::ip::tcp::endpoint(asio::ip::make_address(address), 80);
+  };
+  auto endpoints = salt::tcp_client::_interleave_address_family(
+      {make_endpoint("10.0.0.1"), make_endpoint("::1"),
+       make_endpoint("10.0.0.2"), make_endpoint("10.0.0.3"),
+       make_endpoint("::2")});
+  std::vector<std::string> addresses;
+  for (const auto &endpoint : endpoints) {
+    addresses.push_back(salt::endpoint_address(endpoint));
+  }
+  ASSERT_EQ(addresses, (std::vector<std::string>{"::1", "10.0.0.1", "::2",
+                                                 "10.0.0.2", "10.0.0.3"}));
+}
+
+TEST(tcp_client_test, connect_timeout) {
+  asio::io_context io_context;
+  blackhole_listener blackhole(io_context);
+
+  std::atomic<int> connected_cnt{0};
+  auto notify = std::make_unique<connected_notify>(connected_cnt);
+  auto notify_ptr = notify.get();
+  salt::tcp_client client;
+  client.set_transfer_thread_count(1)
+      .set_assemble_creator([] { return new discard_packet_assemble; })
+      .set_notify(std::move(notify));
+  salt::connection_meta meta;
+  meta.retry_when_connection_error = false;
+  meta.connect_timeout = std::chrono::milliseconds(100);
+  client.connect("127.0.0.2", blackhole.endpoint().port(), meta);
+
+  ASSERT_TRUE(wait_until([notify_ptr] {
+    return !!notify_ptr->disconnect_code();
+  }));
+  ASSERT_EQ(notify_ptr->disconnect_code(), asio::error::timed_out);
+  ASSERT_EQ(connected_cnt, 0);
+}
+
+TEST(tcp_client_test, connect_timeout_next_endpoint) {
+  asio::io_context io_context;
+  blackhole_listener blackhole(io_context);
+  auto port = blackhole.endpoint().port();
+  asio::ip::tcp::acceptor acceptor(
+      io_context,
+      asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), port));
+
+  std::atomic<int> connected_cnt{0};
+  salt::tcp_client client;
+  client.set_transfer_thread_count(1)
+      .set_assemble_creator([] { return new discard_packet_assemble; })
+      .set_notify(std::make_unique<connected_notify>(connected_cnt));
+  // 第一个地址超时以后连接第二个地址
+  seed_resolve_cache(client, "salt.test", {"127.0.0.2", "127.0.0.1"});
+  salt::connection_meta meta;
+  meta.connect_timeout = std::chrono::milliseconds(100);
+  auto begin = std::chrono::steady_clock::now();
+  client.connect("salt.test", port, meta);
+
+  asio::ip::tcp::socket socket(io_context);
+  acceptor.accept(socket);
+  ASSERT_TRUE(wait_until([&connected_cnt] { return connected_cnt == 1; }));
+  ASSERT_GE(std::chrono::steady_clock::now() - begin,
+            std::chrono::milliseconds(100));
+  client.stop();
+}
+
+TEST(tcp_client_test, drain_drop_waiting_connect) {
+  asio::io_context io_context;
+  blackhole_listener blackhole(io_context);
+
+  std::atomic<int> connected_cnt{0};
+  auto notify = std::make_unique<connected_notify>(connected_cnt);
+  auto notify_ptr = notify.get();
+  salt::tcp_client client;
+  client.set_transfer_thread_count(1)
+      .set_max_concurrent_connects(1)
+      .set_assemble_creator([] { return new discard_packet_assemble; })
+      .set_notify(std::move(notify));
+  salt::connection_meta meta;
+  meta.connect_timeout = std::chrono::milliseconds(100);
+  // 第二个链接等待第一个链接完成，drain 以后不再发起连接，两个链接都会被丢弃
+  client.connect("127.0.0.2", blackhole.endpoint().port(), meta);
+  client.connect("127.0.0.2", blackhole.endpoint().port(), meta);
+  std::promise<void> drained;
+  client.drain(std::chrono::seconds(1),
+               [&drained](const salt::drain_result &) { drained.set_value(); });
+  drained.get_future().wait();
+
+  ASSERT_TRUE(
+      wait_until([notify_ptr] { return notify_ptr->dropped_cnt_ == 2; }));
+  ASSERT_EQ(connected_cnt, 0);
+  client.stop();
+}
+
+TEST(tcp_client_test, service_candidates_cached) {
+  asio::io_context io_context;
+  asio::ip::tcp::acceptor acceptor(
+      io_context,
+      asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+
+  std::atomic<int> connected_cnt{0};
+  salt::tcp_client client;
+  client.set_transfer_thread_count(1)
+      .set_assemble_creator([] { return new discard_packet_assemble; })
+      .set_notify(std::make_unique<connected_notify>(connected_cnt));
+  salt::service_meta meta;
+  meta.connections_per_endpoint = 2;
+  meta.connection.retry_when_connection_error = false;
+  client.add_service("echo", {{"127.0.0.1", acceptor.local_endpoint().port()}},
+                     meta);
+
+  asio::ip::tcp::socket first(io_context);
+  asio::ip::tcp::socket second(io_context);
+  acceptor.accept(first);
+  acceptor.accept(second);
+  ASSERT_TRUE(wait_until([&connected_cnt] { return connected_cnt == 2; }));
+
+  auto service = std::atomic_load(&client.services_)->at("echo");
+  auto send = [&client] {
+    std::promise<std::error_code> sent;
+    client.send("echo", "data", [&sent](const std::error_code &error_code) {
+      sent.set_value(error_code);
+    });
+    return sent.get_future().get();
+  };
+  // 链接没有变化时复用候选链接
+  ASSERT_FALSE(send());
+  auto candidates = std::atomic_load(&service->candidates);
+  ASSERT_EQ(candidates->handles.size(), 2u);
+  ASSERT_FALSE(send());
+  ASSERT_EQ(std::atomic_load(&service->candidates), candidates);
+
+  // 链接断开以后重新生成
+  first.close();
+  ASSERT_TRUE(wait_until([&client] { return client.connected_.size() == 1; }));
+  ASSERT_FALSE(send());
+  ASSERT_EQ(std::atomic_load(&service->candidates)->handles.size(), 1u);
+  client.stop();
+}
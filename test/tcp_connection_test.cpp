@@ -0,0 +1,159 @@
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asio.hpp"
+
+#include "salt/core/error.h"
+#include "salt/core/tcp_connection.h"
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+class discard_packet_assemble : public salt::base_packet_assemble {
+public:
+  using salt::base_packet_assemble::data_received;
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> /* connection */,
+                std::string /* data */) override {
+    return salt::data_read_result::success;
+  }
+};
+
+/**
+ * @brief 用 socketpair 创建链接，peer 为另一端
+ *
+ */
+static std::shared_ptr<salt::tcp_connection>
+make_connection(asio::io_context &io_context,
+                asio::local::stream_protocol::socket &peer,
+                std::function<void(const std::string &, uint16_t,
+                                   const std::error_code &)>
+                    read_notify_callback = nullptr) {
+  auto connection = salt::tcp_connection::create(
+      io_context, new discard_packet_assemble,
+      std::move(read_notify_callback), true);
+  asio::local::stream_protocol::socket socket(io_context);
+  asio::local::connect_pair(socket, peer);
+  connection->get_socket().assign(
+      asio::generic::stream_protocol(AF_UNIX, 0), socket.release());
+  return connection;
+}
+
+static std::string read_exactly(asio::local::stream_protocol::socket &peer,
+                                std::size_t size) {
+  std::string data(size, '\0');
+  asio::read(peer, asio::buffer(data));
+  return data;
+}
+
+TEST(tcp_connection_test, batch_queued_sends) {
+  asio::io_context io_context;
+  asio::local::stream_protocol::socket peer(io_context);
+  auto connection = make_connection(io_context, peer);
+  connection->set_send_batch_max_bytes(10);
+
+  std::vector<int> completed;
+  for (auto i = 0; i < 5; ++i) {
+    connection->send("abc" + std::to_string(i),
+                     [&completed, i](const std::error_code &error_code) {
+                       ASSERT_FALSE(error_code);
+                       completed.push_back(i);
+                     });
+  }
+
+  // 超过批量大小以后停止合并，一次写操作发送前3个数据
+  io_context.poll_one();
+  ASSERT_EQ(connection->sending_items_.size(), 3u);
+  ASSERT_EQ(connection->send_items_.size(), 2u);
+
+  io_context.run();
+  ASSERT_EQ(completed, (std::vector<int>{0, 1, 2, 3, 4}));
+  ASSERT_EQ(read_exactly(peer, 20), "abc0abc1abc2abc3abc4");
+  ASSERT_EQ(connection->pending_send_bytes(), 0u);
+}
+
+TEST(tcp_connection_test, watermark_and_queue_full) {
+  asio::io_context io_context;
+  asio::local::stream_protocol::socket peer(io_context);
+  auto connection = make_connection(io_context, peer);
+  salt::send_buffer_policy policy;
+  policy.high_watermark = 8;
+  policy.low_watermark = 4;
+  policy.max_bytes = 20;
+  connection->set_send_buffer_policy(policy);
+
+  std::vector<bool> states;
+  connection->set_write_state_callback(
+      [&states](bool congested) { states.push_back(congested); });
+  io_context.poll();
+  io_context.restart();
+
+  std::size_t success_cnt{0};
+  std::size_t full_cnt{0};
+  auto call_back = [&](const std::error_code &error_code) {
+    if (!error_code) {
+      ++success_cnt;
+    } else if (error_code ==
+               salt::make_error_code(salt::error_code::send_queue_full)) {
+      ++full_cnt;
+    }
+  };
+  // 第3个数据超过高水位，第6个数据超过字节数上限
+  for (auto i = 0; i < 6; ++i) {
+    connection->send("data", call_back);
+  }
+  ASSERT_EQ(connection->pending_send_bytes(), 20u);
+
+  // 发送完成以后降到低水位以下，恢复可写
+  io_context.run();
+  ASSERT_EQ(states, (std::vector<bool>{true, false}));
+  ASSERT_EQ(success_cnt, 5u);
+  ASSERT_EQ(full_cnt, 1u);
+  ASSERT_EQ(connection->pending_send_bytes(), 0u);
+  ASSERT_EQ(read_exactly(peer, 20), "datadatadatadatadata");
+}
+
+TEST(tcp_connection_test, close_from_other_thread) {
+  asio::io_context io_context;
+  asio::local::stream_protocol::socket peer(io_context);
+  std::error_code notified;
+  auto connection = make_connection(
+      io_context, peer,
+      [&notified](const std::string &, uint16_t,
+                  const std::error_code &error_code) {
+        notified = error_code;
+      });
+  ASSERT_TRUE(connection->read());
+
+  std::thread([handle = connection->get_handle()] { handle->close(); })
+      .join();
+  io_context.run();
+  ASSERT_EQ(notified,
+            salt::make_error_code(salt::error_code::require_disconnecet));
+  ASSERT_FALSE(connection->get_socket().is_open());
+}
+
+TEST(tcp_connection_test, disconnect_abort_queued_sends) {
+  asio::io_context io_context;
+  asio::local::stream_protocol::socket peer(io_context);
+  auto connection = make_connection(io_context, peer);
+
+  std::vector<std::error_code> results;
+  for (auto i = 0; i < 3; ++i) {
+    connection->send("data", [&results](const std::error_code &error_code) {
+      results.push_back(error_code);
+    });
+  }
+  // 写操作还没有发起就断开，队列中的数据以 operation_aborted 完成
+  connection->disconnect();
+  ASSERT_TRUE(results.empty());
+  io_context.run();
+  ASSERT_EQ(results, std::vector<std::error_code>(
+                         3, asio::error::make_error_code(
+                                asio::error::operation_aborted)));
+  ASSERT_EQ(connection->pending_send_bytes(), 0u);
+}
+#endif
@@ -0,0 +1,295 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "asio.hpp"
+
+#include "salt/core/error.h"
+#include "salt/core/tcp_server.h"
+
+class discard_packet_assemble : public salt::base_packet_assemble {
+public:
+  using salt::base_packet_assemble::data_received;
+
+  salt::data_read_result
+  data_received(std::shared_ptr<salt::connection_handle> connection,
+                std::string s) override {
+    return salt::data_read_result::success;
+  }
+};
+
+static salt::base_packet_assemble *create_discard_assemble() {
+  return new discard_packet_assemble;
+}
+
+static bool wait_until(const std::function<bool()> &predicate) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(tcp_server_test, graceful_stop_flush_and_fin) {
+  salt::tcp_server server;
+  server.set_assemble_creator(create_discard_assemble)
+      .set_listen_ip_v4("127.0.0.1")
+      .set_listen_port(0);
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+
+  asio::io_context io_context;
+  asio::ip::tcp::socket socket(io_context);
+  socket.connect(asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+                                         server.get_listen_port()));
+  ASSERT_TRUE(wait_until([&server] { return server.connection_count() == 1; }));
+
+  // 客户端还没有读取，大部分数据留在服务器的发送队列中
+  std::string payload(8 * 1024 * 1024, 'x');
+  std::atomic<int> sent_cnt{0};
+  server.broadcast(payload, [&sent_cnt](const std::error_code &error_code) {
+    if (!error_code) {
+      ++sent_cnt;
+    }
+  });
+  auto stopped = std::async(std::launch::async, [&server] {
+    return server.graceful_stop(std::chrono::seconds(5));
+  });
+
+  std::vector<char> buffer(64 * 1024);
+  std::size_t received{0};
+  std::error_code err_code;
+  while (!err_code) {
+    received += socket.read_some(asio::buffer(buffer), err_code);
+  }
+  ASSERT_EQ(err_code, asio::error::eof);
+  ASSERT_EQ(received, payload.size());
+
+  auto result = stopped.get();
+  ASSERT_EQ(sent_cnt, 1);
+  ASSERT_EQ(result.connections.size(), 1u);
+  ASSERT_EQ(result.timeout_count, 0u);
+  ASSERT_EQ(result.dropped_bytes, 0u);
+}
+
+TEST(tcp_server_test, concurrent_send_order) {
+  salt::tcp_server server;
+  server.set_assemble_creator(create_discard_assemble)
+      .set_listen_ip_v4("127.0.0.1")
+      .set_listen_port(0)
+      .set_transfer_thread_count(2);
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+
+  asio::io_context io_context;
+  asio::ip::tcp::socket socket(io_context);
+  socket.connect(asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+                                         server.get_listen_port()));
+  ASSERT_TRUE(wait_until([&server] { return server.connection_count() == 1; }));
+  std::shared_ptr<salt::connection_handle> handle;
+  server.for_each(
+      [&handle](const std::shared_ptr<salt::connection_handle> &connection) {
+        handle = connection;
+      });
+  ASSERT_TRUE(handle);
+
+  // 多个线程同时发送，每个线程发送的数据保持顺序，每个回调只调用一次
+  constexpr uint32_t producer_cnt = 4;
+  constexpr uint32_t message_cnt = 10000;
+  std::vector<std::atomic<uint32_t>> call_back_cnt(producer_cnt * message_cnt);
+  std::vector<std::thread> producers;
+  for (uint32_t producer = 0; producer < producer_cnt; ++producer) {
+    producers.emplace_back([&, producer] {
+      for (uint32_t seq = 0; seq < message_cnt; ++seq) {
+        uint32_t message[2] = {producer, seq};
+        auto index = producer * message_cnt + seq;
+        handle->send(
+            std::string(reinterpret_cast<const char *>(message),
+                        sizeof(message)),
+            [&call_back_cnt, index](const std::error_code &error_code) {
+              if (!error_code) {
+                ++call_back_cnt[index];
+              }
+            });
+      }
+    });
+  }
+
+  std::vector<uint32_t> next_seq(producer_cnt, 0);
+  std::string data;
+  std::vector<char> buffer(64 * 1024);
+  while (data.size() < producer_cnt * message_cnt * sizeof(uint32_t) * 2) {
+    std::error_code err_code;
+    auto size = socket.read_some(asio::buffer(buffer), err_code);
+    ASSERT_FALSE(err_code);
+    data.append(buffer.data(), size);
+  }
+  for (std::size_t offset = 0; offset < data.size();
+       offset += sizeof(uint32_t) * 2) {
+    uint32_t message[2];
+    std::memcpy(message, data.data() + offset, sizeof(message));
+    ASSERT_LT(message[0], producer_cnt);
+    ASSERT_EQ(message[1], next_seq[message[0]]++);
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  ASSERT_TRUE(wait_until([&call_back_cnt] {
+    for (auto &cnt : call_back_cnt) {
+      if (cnt.load() == 0) {
+        return false;
+      }
+    }
+    return true;
+  }));
+  for (auto &cnt : call_back_cnt) {
+    ASSERT_EQ(cnt.load(), 1u);
+  }
+  server.stop();
+}
+
+TEST(tcp_server_test, concurrent_drain) {
+  salt::tcp_server server;
+  server.set_assemble_creator(create_discard_assemble)
+      .set_listen_ip_v4("127.0.0.1")
+      .set_listen_port(0);
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+
+  // 模拟一个还在传输线程中初始化的链接，两次 drain 都要等待它完成
+  {
+    std::lock_guard<std::mutex> lock(server.accept_mutex_);
+    ++server.accepting_count_;
+  }
+  std::promise<void> first;
+  std::promise<void> second;
+  server.drain(std::chrono::seconds(1),
+               [&first](const salt::drain_result &) { first.set_value(); });
+  server.drain(std::chrono::seconds(1),
+               [&second](const salt::drain_result &) { second.set_value(); });
+  ASSERT_TRUE(wait_until([&server] {
+    std::lock_guard<std::mutex> lock(server.accept_mutex_);
+    return server.pending_drains_.size() == 2;
+  }));
+
+  std::vector<std::function<void()>> pending_drains;
+  {
+    std::lock_guard<std::mutex> lock(server.accept_mutex_);
+    --server.accepting_count_;
+    pending_drains.swap(server.pending_drains_);
+  }
+  for (auto &pending_drain : pending_drains) {
+    pending_drain();
+  }
+  ASSERT_EQ(first.get_future().wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  ASSERT_EQ(second.get_future().wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  server.stop();
+}
+
+TEST(tcp_server_test, init_then_per_thread_mode) {
+  // init 只记录线程数量，之后设置的传输模式在 start 时生效
+  salt::tcp_server server;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+  ASSERT_TRUE(server.init("127.0.0.1", 0, 2));
+#pragma GCC diagnostic pop
+  server.set_assemble_creator(create_discard_assemble)
+      .set_transfer_io_mode(salt::transfer_io_mode::per_thread);
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+  ASSERT_TRUE(server.io_threads_.empty());
+  ASSERT_EQ(server.per_thread_io_threads_.size(), 2u);
+  server.stop();
+}
+
+TEST(tcp_server_test, restart_after_listen_error) {
+  // 端口被没有设置 SO_REUSEPORT 的 socket 占用，监听失败
+  asio::io_context io_context;
+  asio::ip::tcp::acceptor blocker(
+      io_context,
+      asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+  auto port = blocker.local_endpoint().port();
+
+  salt::tcp_server server;
+  server.set_assemble_creator(create_discard_assemble)
+      .set_listen_ip_v4("127.0.0.1")
+      .set_listen_port(port)
+      .set_acceptor_count(2);
+  ASSERT_EQ(server.start(), asio::error::address_in_use);
+  ASSERT_TRUE(server.acceptors_.empty());
+
+  // 端口释放以后可以重新启动
+  blocker.close();
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+  ASSERT_EQ(server.acceptors_.size(), 2u);
+  asio::ip::tcp::socket socket(io_context);
+  socket.connect(
+      asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), port));
+  ASSERT_TRUE(wait_until([&server] { return server.connection_count() == 1; }));
+  server.stop();
+}
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+static bool socket_file_exists(const std::string &path) {
+  struct stat file_stat;
+  return ::stat(path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode);
+}
+
+TEST(tcp_server_test, unix_path_in_use) {
+  auto path = "/tmp/salt_server_test_" + std::to_string(::getpid()) + ".sock";
+  salt::socket_option option;
+  option.no_delay = true;
+  option.quick_ack = true;
+
+  salt::tcp_server running;
+  running.set_assemble_creator(create_discard_assemble)
+      .set_socket_option(option)
+      .set_listen_unix_path(path);
+  ASSERT_EQ(running.start(), salt::make_error_code(salt::error_code::success));
+  // 只在监听时去掉 tcp 选项，不修改设置的选项
+  ASSERT_EQ(running.socket_option_.no_delay, true);
+  ASSERT_EQ(running.socket_option_.quick_ack, true);
+
+  // 有服务器在监听时不能删除 socket 文件
+  salt::tcp_server second;
+  second.set_assemble_creator(create_discard_assemble)
+      .set_listen_unix_path(path);
+  ASSERT_EQ(second.start(), asio::error::address_in_use);
+  ASSERT_TRUE(socket_file_exists(path));
+  second.stop();
+  ASSERT_TRUE(socket_file_exists(path));
+
+  running.stop();
+  ASSERT_FALSE(socket_file_exists(path));
+}
+
+TEST(tcp_server_test, unix_path_stale) {
+  auto path = "/tmp/salt_stale_test_" + std::to_string(::getpid()) + ".sock";
+  {
+    // 关闭监听 socket 但是不删除文件，模拟上一次运行异常退出
+    asio::io_context io_context;
+    asio::local::stream_protocol::acceptor acceptor(
+        io_context, asio::local::stream_protocol::endpoint(path));
+  }
+  ASSERT_TRUE(socket_file_exists(path));
+
+  salt::tcp_server server;
+  server.set_assemble_creator(create_discard_assemble)
+      .set_listen_unix_path(path);
+  ASSERT_EQ(server.start(), salt::make_error_code(salt::error_code::success));
+  server.stop();
+  ASSERT_FALSE(socket_file_exists(path));
+}
+#endif
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <vector>
+
+#include "salt/util/timing_wheel.h"
+
+using namespace std::chrono_literals;
+
+TEST(timing_wheel_test, fire) {
+  auto start = salt::timing_wheel::clock::now();
+  salt::timing_wheel wheel{10ms, 8, start};
+  auto fired = 0;
+  wheel.add(25ms, [&fired] { ++fired; });
+  ASSERT_EQ(wheel.size(), 1);
+
+  ASSERT_EQ(wheel.advance(start + 20ms), 0);
+  ASSERT_EQ(fired, 0);
+  ASSERT_EQ(wheel.advance(start + 30ms), 1);
+  ASSERT_EQ(fired, 1);
+  ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(timing_wheel_test, cancel) {
+  auto start = salt::timing_wheel::clock::now();
+  salt::timing_wheel wheel{10ms, 8, start};
+  auto fired = 0;
+  auto id = wheel.add(10ms, [&fired] { ++fired; });
+  ASSERT_TRUE(wheel.cancel(id));
+  ASSERT_FALSE(wheel.cancel(id));
+  ASSERT_EQ(wheel.advance(start + 100ms), 0);
+  ASSERT_EQ(fired, 0);
+}
+
+TEST(timing_wheel_test, multi_round) {
+  auto start = salt::timing_wheel::clock::now();
+  salt::timing_wheel wheel{10ms, 4, start};
+  std::vector<int> fired;
+  wheel.add(10ms, [&fired] { fired.push_back(1); });
+  wheel.add(50ms, [&fired] { fired.push_back(5); });
+  wheel.add(90ms, [&fired] { fired.push_back(9); });
+
+  for (auto i = 1; i <= 10; ++i) {
+    wheel.advance(start + i * 10ms);
+    if (i == 1) {
+      ASSERT_EQ(fired, std::vector<int>({1}));
+    } else if (i == 5) {
+      ASSERT_EQ(fired, std::vector<int>({1, 5}));
+    } else if (i == 9) {
+      ASSERT_EQ(fired, std::vector<int>({1, 5, 9}));
+    }
+  }
+  ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(timing_wheel_test, add_in_callback) {
+  auto start = salt::timing_wheel::clock::now();
+  salt::timing_wheel wheel{10ms, 8, start};
+  auto fired = 0;
+  std::function<void()> rearm = [&] {
+    ++fired;
+    if (fired < 3) {
+      wheel.add(10ms, rearm);
+    }
+  };
+  wheel.add(10ms, rearm);
+  for (auto i = 1; i <= 5; ++i) {
+    wheel.advance(start + i * 10ms);
+  }
+  ASSERT_EQ(fired, 3);
+}
+
+TEST(timing_wheel_test, large_jump) {
+  auto start = salt::timing_wheel::clock::now();
+  salt::timing_wheel wheel{10ms, 4, start};
+  auto fired = 0;
+  for (auto i = 1; i <= 20; ++i) {
+    wheel.add(i * 10ms, [&fired] { ++fired; });
+  }
+  ASSERT_EQ(wheel.advance(start + 1s), 20);
+  ASSERT_EQ(fired, 20);
+}
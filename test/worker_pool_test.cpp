@@ -0,0 +1,177 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "salt/core/worker_pool.h"
+#include "salt/packet_assemble/dispatch_notify.h"
+
+TEST(worker_pool_test, run_all_tasks) {
+  std::atomic<uint32_t> count{0};
+  {
+    salt::worker_pool pool{4};
+    ASSERT_EQ(pool.thread_count(), 4);
+    for (auto i = 0; i < 10000; ++i) {
+      pool.post([&count] { ++count; });
+    }
+  }
+  ASSERT_EQ(count, 10000);
+}
+
+TEST(worker_pool_test, no_stalled_task) {
+  // 多个线程同时提交任务，部分任务在线程池中继续提交。所有任务都要在期限内
+  // 执行完，不能因为被唤醒的线程窃取失败而一直留在队列中
+  constexpr auto producer_count = 8;
+  constexpr auto task_count = 5000;
+  constexpr auto total = producer_count * task_count * 2;
+  salt::worker_pool pool{4};
+  std::atomic<uint32_t> count{0};
+  std::vector<std::thread> producers;
+  for (auto p = 0; p < producer_count; ++p) {
+    producers.emplace_back([&] {
+      for (auto i = 0; i < task_count; ++i) {
+        pool.post([&] {
+          ++count;
+          pool.post([&count] { ++count; });
+        });
+      }
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (count.load() != total &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(count.load(), total);
+}
+
+TEST(worker_pool_test, post_after_stop) {
+  std::atomic<uint32_t> count{0};
+  salt::worker_pool pool{2};
+  pool.stop();
+  pool.post([&count] { ++count; });
+  ASSERT_EQ(count, 0);
+}
+
+TEST(worker_pool_test, serial_queue_order) {
+  constexpr auto queue_count = 8;
+  constexpr auto task_count = 2000;
+  std::vector<std::vector<int>> results(queue_count);
+  std::atomic<bool> overlapped{false};
+  std::vector<std::atomic<uint32_t>> in_queue(queue_count);
+  {
+    salt::worker_pool pool{4};
+    std::vector<std::shared_ptr<salt::worker_serial_queue>> queues;
+    for (auto i = 0; i < queue_count; ++i) {
+      queues.push_back(salt::worker_serial_queue::create(pool));
+    }
+
+    std::vector<std::thread> producers;
+    for (auto q = 0; q < queue_count; ++q) {
+      producers.emplace_back([&, q] {
+        for (auto i = 0; i < task_count; ++i) {
+          queues[q]->post([&, q, i] {
+            if (in_queue[q].fetch_add(1) != 0) {
+              overlapped = true;
+            }
+            results[q].push_back(i);
+            in_queue[q].fetch_sub(1);
+          });
+        }
+      });
+    }
+    for (auto &producer : producers) {
+      producer.join();
+    }
+  }
+
+  ASSERT_FALSE(overlapped);
+  for (const auto &result : results) {
+    ASSERT_EQ(result.size(), task_count);
+    for (auto i = 0; i < task_count; ++i) {
+      ASSERT_EQ(result[i], i);
+    }
+  }
+}
+
+struct dispatch_header {
+  uint32_t len;
+};
+
+class record_notify
+    : public salt::header_body_assemble_notify<dispatch_header> {
+public:
+  record_notify(std::vector<std::string> &bodies,
+                std::vector<std::thread::id> &threads)
+      : bodies_(bodies), threads_(threads) {}
+
+  salt::data_read_result
+  packet_reserved(std::shared_ptr<salt::connection_handle> connection,
+                  std::string raw_header_data, std::string body) override {
+    bodies_.push_back(std::move(body));
+    threads_.push_back(std::this_thread::get_id());
+    return salt::data_read_result::success;
+  }
+
+private:
+  std::vector<std::string> &bodies_;
+  std::vector<std::thread::id> &threads_;
+};
+
+TEST(worker_pool_test, dispatch_notify) {
+  std::vector<std::string> bodies;
+  std::vector<std::thread::id> threads;
+  {
+    salt::worker_pool pool{2};
+    auto notify = salt::make_dispatch_notify<dispatch_header>(
+        pool, std::make_unique<record_notify>(bodies, threads));
+    for (auto i = 0; i < 100; ++i) {
+      ASSERT_EQ(notify->packet_reserved(nullptr, "", std::to_string(i)),
+                salt::data_read_result::success);
+    }
+  }
+
+  ASSERT_EQ(bodies.size(), 100);
+  for (auto i = 0; i < 100; ++i) {
+    ASSERT_EQ(bodies[i], std::to_string(i));
+    ASSERT_NE(threads[i], std::this_thread::get_id());
+  }
+}
+
+class close_record_connection : public salt::connection_handle {
+public:
+  void send(std::string data,
+            std::function<void(const std::error_code &)> call_back) override {}
+  void close() override { ++close_cnt_; }
+
+  std::atomic<uint32_t> close_cnt_{0};
+};
+
+class disconnect_notify
+    : public salt::header_body_assemble_notify<dispatch_header> {
+public:
+  salt::data_read_result
+  packet_reserved(std::shared_ptr<salt::connection_handle> connection,
+                  std::string raw_header_data, std::string body) override {
+    return salt::data_read_result::disconnect;
+  }
+};
+
+TEST(worker_pool_test, dispatch_notify_disconnect) {
+  auto connection = std::make_shared<close_record_connection>();
+  {
+    salt::worker_pool pool{2};
+    auto notify = salt::make_dispatch_notify<dispatch_header>(
+        pool, std::make_unique<disconnect_notify>());
+    ASSERT_EQ(notify->packet_reserved(connection, "", "body"),
+              salt::data_read_result::success);
+  }
+  ASSERT_EQ(connection->close_cnt_, 1u);
+}